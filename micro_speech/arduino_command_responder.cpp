@@ -31,7 +31,7 @@ USBKeyboard Keyboard;
 
 // Toggles the built-in LED every inference, and lights a colored LED depending
 // on which word was detected.
-void RespondToCommand(int32_t current_time, const char* found_command,
+void RespondToCommand(int64_t current_time_ms, const char* found_command,
                       uint8_t score, bool is_new_command) {
   static bool is_initialized = false;
   if (!is_initialized) {
@@ -48,11 +48,14 @@ void RespondToCommand(int32_t current_time, const char* found_command,
     digitalWrite(LEDB, HIGH);
     is_initialized = true;
   }
-  static int32_t last_command_time = 0;
+  static int64_t last_command_time = 0;
   static int count = 0;
 
   if (is_new_command) {
-    MicroPrintf("Heard %s (%d) @%dms", found_command, score, current_time);
+    // MicroPrintf has no 64-bit conversions, so print seconds and milliseconds
+    MicroPrintf("Heard %s (%d) @%d.%03ds", found_command, score,
+                static_cast<int>(current_time_ms / 1000),
+                static_cast<int>(current_time_ms % 1000));
     // If we hear a command, light up the appropriate LED
     digitalWrite(LEDR, HIGH);
     digitalWrite(LEDG, HIGH);
@@ -70,13 +73,13 @@ void RespondToCommand(int32_t current_time, const char* found_command,
       // silence
     }
 
-    last_command_time = current_time;
+    last_command_time = current_time_ms;
   }
 
   // If last_command_time is non-zero but was >3 seconds ago, zero it
   // and switch off the LED.
   if (last_command_time != 0) {
-    if (last_command_time < (current_time - 3000)) {
+    if (last_command_time < (current_time_ms - 3000)) {
       last_command_time = 0;
       digitalWrite(LEDR, HIGH);
       digitalWrite(LEDG, HIGH);
@@ -0,0 +1,149 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#if defined(ARDUINO) && !defined(ARDUINO_ARDUINO_NANO33BLE)
+#define ARDUINO_EXCLUDE_CODE
+#endif  // defined(ARDUINO) && !defined(ARDUINO_ARDUINO_NANO33BLE)
+
+#ifndef ARDUINO_EXCLUDE_CODE
+
+#include <mbed.h>
+
+#include <cstdint>
+
+#include "pipeline_snapshot.h"
+#include "snapshot_store.h"
+#include "tensorflow/lite/micro/micro_log.h"
+
+// Bounds the GCC linker scripts of mbed's targets define, as CMSIS's do: what
+// the startup code copies from flash (.data) and zeroes (.bss), the heap and
+// the main stack. Weak, so a script that doesn't define one leaves it null.
+extern "C" {
+extern uint8_t __data_start__[] __attribute__((weak));
+extern uint8_t __data_end__[] __attribute__((weak));
+extern uint8_t __bss_start__[] __attribute__((weak));
+extern uint8_t __bss_end__[] __attribute__((weak));
+extern uint8_t __end__[] __attribute__((weak));
+extern uint8_t __HeapLimit[] __attribute__((weak));
+extern uint8_t __StackLimit[] __attribute__((weak));
+extern uint8_t __StackTop[] __attribute__((weak));
+}
+
+namespace {
+
+// Room for the sketch's snapshot.
+constexpr int kSnapshotRecordCapacity = sizeof(PipelineSnapshot<>);
+
+// The nRF52840's 256kB of RAM.
+constexpr uint32_t kRamStart = 0x20000000;
+constexpr uint32_t kRamEnd = kRamStart + 0x40000;
+
+// In .noinit, meant to be left as the last run left it by the startup code. A
+// cold boot finds garbage here, which fails the snapshot's checks. That only
+// holds if the core's linker script gives .noinit a NOLOAD output section of
+// its own in RAM, which couldn't be checked against the mbed core's script
+// when this was written. Without one, ld places it as an orphan section next
+// to whatever it likes, possibly in the heap, so IsRecordUntouched() checks
+// where it actually landed before it's used.
+alignas(8) uint8_t g_snapshot_record[kSnapshotRecordCapacity]
+    __attribute__((section(".noinit")));
+
+// Whether [start, end) and the linker-defined span [span_start, span_end)
+// share any bytes.
+bool Overlaps(uint32_t start, uint32_t end, const uint8_t* span_start,
+              const uint8_t* span_end) {
+  return (start < reinterpret_cast<uint32_t>(span_end)) &&
+         (reinterpret_cast<uint32_t>(span_start) < end);
+}
+
+// Whether the record is in RAM that neither the startup code, the heap nor the
+// main stack touch, going by the linker script's own symbols. If any of them
+// is missing it can't tell, and says no.
+bool IsRecordUntouched() {
+  const uint32_t start = reinterpret_cast<uint32_t>(g_snapshot_record);
+  const uint32_t end = start + kSnapshotRecordCapacity;
+  if ((start < kRamStart) || (end > kRamEnd)) {
+    return false;
+  }
+  const uint8_t* const spans[][2] = {
+      {__data_start__, __data_end__},
+      {__bss_start__, __bss_end__},
+      {__end__, __HeapLimit},
+      {__StackLimit, __StackTop},
+  };
+  for (const auto& span : spans) {
+    if ((span[0] == nullptr) || (span[1] == nullptr) ||
+        Overlaps(start, end, span[0], span[1])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The nRF52840's RAM is in 4kB sections in RAM0 to RAM7, 8kB each, then 32kB
+// sections in RAM8. Only sections with their retention bit set keep their
+// contents in System OFF.
+void RetainRam(uint32_t start, uint32_t end) {
+  constexpr uint32_t kSmallBlocksSize = 8 * 0x2000;
+  for (uint32_t address = start & ~0xfffu; address < end;) {
+    const uint32_t offset = address - kRamStart;
+    int block;
+    int section;
+    uint32_t section_size;
+    if (offset < kSmallBlocksSize) {
+      block = offset / 0x2000;
+      section = (offset % 0x2000) / 0x1000;
+      section_size = 0x1000;
+    } else {
+      block = 8;
+      section = (offset - kSmallBlocksSize) / 0x8000;
+      section_size = 0x8000;
+    }
+    NRF_POWER->RAM[block].POWERSET =
+        1u << (POWER_RAM_POWERSET_S0RETENTION_Pos + section);
+    address = (address - (offset % section_size)) + section_size;
+  }
+}
+
+}  // namespace
+
+// Returns null, so the sketch takes no snapshots, if the record isn't
+// somewhere a reset leaves alone.
+void* SnapshotRecord(int size) {
+  if (size > kSnapshotRecordCapacity) {
+    return nullptr;
+  }
+  static bool is_checked = false;
+  static bool is_usable = false;
+  if (!is_checked) {
+    is_checked = true;
+    is_usable = IsRecordUntouched();
+    const uint32_t start = reinterpret_cast<uint32_t>(g_snapshot_record);
+    if (is_usable) {
+      RetainRam(start, start + kSnapshotRecordCapacity);
+    } else {
+      MicroPrintf(
+          "Snapshots off: .noinit at 0x%x isn't clear of .data, .bss, the "
+          "heap and the stack",
+          static_cast<unsigned>(start));
+    }
+  }
+  return is_usable ? g_snapshot_record : nullptr;
+}
+
+// Retained RAM holds whatever was written last, so there's nothing to do.
+void SaveSnapshotRecord() {}
+
+#endif  // ARDUINO_EXCLUDE_CODE
@@ -0,0 +1,145 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "audio_conditioner.h"
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+#include <arm_acle.h>
+#endif
+
+namespace {
+
+constexpr int kInputBits = 12;
+constexpr int kInputShift = 3;
+constexpr int kCoefficientBits = 14;
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+
+// The Cortex-M4 DSP instructions, through the ACLE intrinsics.
+inline uint32_t Qsub16(uint32_t a, uint32_t b) { return __qsub16(a, b); }
+inline uint32_t Ssub16(uint32_t a, uint32_t b) { return __ssub16(a, b); }
+inline uint32_t Ssat16To12Bits(uint32_t a) { return __ssat16(a, kInputBits); }
+inline int32_t Smuad(uint32_t a, uint32_t b) { return __smuad(a, b); }
+inline int32_t SsatTo16Bits(int32_t a) { return __ssat(a, 16); }
+
+#else  // defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+
+// Portable versions of the instructions above, with the same results.
+
+inline int32_t Low(uint32_t a) { return static_cast<int16_t>(a & 0xffff); }
+inline int32_t High(uint32_t a) { return static_cast<int16_t>(a >> 16); }
+inline uint32_t Pack(int32_t low, int32_t high) {
+  return (static_cast<uint32_t>(low) & 0xffff) |
+         (static_cast<uint32_t>(high) << 16);
+}
+
+inline int32_t Saturate(int32_t a, int bits) {
+  const int32_t max = (1 << (bits - 1)) - 1;
+  const int32_t min = -(1 << (bits - 1));
+  return (a > max) ? max : ((a < min) ? min : a);
+}
+
+inline uint32_t Qsub16(uint32_t a, uint32_t b) {
+  return Pack(Saturate(Low(a) - Low(b), 16), Saturate(High(a) - High(b), 16));
+}
+
+inline uint32_t Ssub16(uint32_t a, uint32_t b) {
+  return Pack(Low(a) - Low(b), High(a) - High(b));
+}
+
+inline uint32_t Ssat16To12Bits(uint32_t a) {
+  return Pack(Saturate(Low(a), kInputBits), Saturate(High(a), kInputBits));
+}
+
+// The sum wraps, as the instruction's does (it sets the Q flag instead).
+inline int32_t Smuad(uint32_t a, uint32_t b) {
+  return static_cast<int32_t>(static_cast<uint32_t>(Low(a) * Low(b)) +
+                              static_cast<uint32_t>(High(a) * High(b)));
+}
+
+inline int32_t SsatTo16Bits(int32_t a) { return Saturate(a, 16); }
+
+#endif  // defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+
+}  // namespace
+
+void InitAudioConditioner(AudioConditioner* conditioner, int16_t pole,
+                          int16_t gain) {
+  conditioner->pole = pole;
+  conditioner->gain = gain;
+  conditioner->previous_input = 0;
+  conditioner->previous_output = 0;
+}
+
+void ConditionAudioBlock(AudioConditioner* conditioner, int16_t* samples,
+                         int count) {
+  // Both samples of a pair are recentred, clamped and differenced with one
+  // instruction each, and each output is one dual multiply-add (SMUAD, the
+  // SMLAD without an accumulator) of (difference, previous output) with
+  // (gain, pole), truncated and saturated to 16 bits.
+  const uint32_t midscale =
+      (kAudioConditionerMidScale << 16) | kAudioConditionerMidScale;
+  const uint32_t coefficients =
+      (static_cast<uint32_t>(static_cast<uint16_t>(conditioner->pole)) << 16) |
+      static_cast<uint16_t>(conditioner->gain);
+  uint32_t previous_input = static_cast<uint16_t>(conditioner->previous_input);
+  uint32_t previous_output =
+      static_cast<uint16_t>(conditioner->previous_output);
+  uint32_t* pairs = reinterpret_cast<uint32_t*>(samples);
+  for (int i = 0; i < count / 2; ++i) {
+    const uint32_t codes = Ssat16To12Bits(Qsub16(pairs[i], midscale));
+    // Shift each half up separately, so the low one's sign doesn't spill.
+    const uint32_t inputs =
+        ((codes << kInputShift) & 0xffff) |
+        ((codes & 0xffff0000) << kInputShift);
+    // The first sample's difference is from the end of the previous pair.
+    const uint32_t differences =
+        Ssub16(inputs, (inputs << 16) | previous_input);
+    const int32_t first = SsatTo16Bits(
+        Smuad((differences & 0xffff) | (previous_output << 16), coefficients) >>
+        kCoefficientBits);
+    const int32_t second = SsatTo16Bits(
+        Smuad((differences >> 16) | (static_cast<uint32_t>(first) << 16),
+              coefficients) >>
+        kCoefficientBits);
+    pairs[i] = (static_cast<uint32_t>(first) & 0xffff) |
+               (static_cast<uint32_t>(second) << 16);
+    previous_input = inputs >> 16;
+    previous_output = static_cast<uint32_t>(second) & 0xffff;
+  }
+  conditioner->previous_input = static_cast<int16_t>(previous_input);
+  conditioner->previous_output = static_cast<int16_t>(previous_output);
+}
+
+void ConditionAudioBlockReference(AudioConditioner* conditioner,
+                                  int16_t* samples, int count) {
+  const int32_t max_input = (1 << (kInputBits - 1)) - 1;
+  const int32_t min_input = -(1 << (kInputBits - 1));
+  for (int i = 0; i < count; ++i) {
+    int32_t code = samples[i] - kAudioConditionerMidScale;
+    code = (code > max_input) ? max_input : code;
+    code = (code < min_input) ? min_input : code;
+    const int32_t input = code * (1 << kInputShift);
+    const int32_t difference = input - conditioner->previous_input;
+    int32_t output = (conditioner->gain * difference +
+                      conditioner->pole * conditioner->previous_output) >>
+                     kCoefficientBits;
+    output = (output > INT16_MAX) ? INT16_MAX : output;
+    output = (output < INT16_MIN) ? INT16_MIN : output;
+    conditioner->previous_input = static_cast<int16_t>(input);
+    conditioner->previous_output = static_cast<int16_t>(output);
+    samples[i] = static_cast<int16_t>(output);
+  }
+}
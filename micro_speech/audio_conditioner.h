@@ -0,0 +1,69 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_AUDIO_CONDITIONER_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_AUDIO_CONDITIONER_H_
+
+#include <cstdint>
+
+// Turns raw 12-bit single-ended SAADC codes into zero-centred, full-scale
+// 16-bit PCM before they reach the feature frontend, so its noise reduction
+// and PCAN gain control don't spend their range on the microphone's bias.
+//
+// Each code is recentred on mid-scale, clamped to 12 bits and shifted up to
+// 15 bits (x), then run through a one-pole DC-blocking high-pass with gain:
+//
+//   y[n] = gain * (x[n] - x[n-1]) + pole * y[n-1]
+//
+// Samples are Q15 and the coefficients Q14, so the gain reaches the last bit
+// of 16-bit output and one dual multiply-add of both terms (SMUAD on the
+// Cortex-M4) can't overflow as long as the pole is below 1.0. The result is
+// truncated rather than rounded, so a constant input settles to within one
+// bit of zero instead of sticking on a rounding dead band. The pole sets the
+// corner frequency, about (1 - pole) * fs / (2 * pi): the default of 0.995
+// puts it at 13Hz at 16kHz.
+struct AudioConditioner {
+  // Q14. The pole must be below 1.0 (16384).
+  int16_t pole;
+  int16_t gain;
+  // The last input, after recentring and shifting, and the last output.
+  int16_t previous_input;
+  int16_t previous_output;
+};
+
+// Raw codes are recentred on this before filtering.
+constexpr int kAudioConditionerMidScale = 1 << 11;
+// 0.995 and just under 2.0 in Q14.
+constexpr int16_t kAudioConditionerDefaultPole = 16302;
+constexpr int16_t kAudioConditionerDefaultGain = 32767;
+
+// Sets the coefficients and starts the filter from silence.
+void InitAudioConditioner(AudioConditioner* conditioner,
+                          int16_t pole = kAudioConditionerDefaultPole,
+                          int16_t gain = kAudioConditionerDefaultGain);
+
+// Conditions `count` raw codes in place. `count` must be even; `samples` must
+// be 4-byte aligned, as DMA blocks in the capture ring are. Uses the
+// Cortex-M4's DSP instructions where they're available, and portable versions
+// of them elsewhere, with identical results.
+void ConditionAudioBlock(AudioConditioner* conditioner, int16_t* samples,
+                         int count);
+
+// The same filter written out directly, one sample at a time, that
+// ConditionAudioBlock() is checked against bit for bit.
+void ConditionAudioBlockReference(AudioConditioner* conditioner,
+                                  int16_t* samples, int count);
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_AUDIO_CONDITIONER_H_
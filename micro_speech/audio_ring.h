@@ -0,0 +1,230 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_AUDIO_RING_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_AUDIO_RING_H_
+
+#include <atomic>
+#include <cstdint>
+
+// A single-producer/single-consumer ring of audio samples, written by the
+// capture interrupt (or a thread standing in for it on the host) and read by
+// the main loop.
+//
+// Positions are 64-bit sample counts since capture started, so they never wrap
+// in practice (about 36 million years at 16kHz). The producer publishes how many
+// samples it has written; the consumer reports the oldest sample it still
+// needs. Anything the producer writes over before the consumer is done with it
+// is counted as an overrun rather than silently handed to the model.
+//
+// The first kMirrorSize samples of the storage are repeated after its end, so
+// any read of up to kMirrorSize samples is one contiguous view into the ring.
+//
+// Cortex-M4 has no 64-bit atomic load or store, so the counters are published
+// with a sequence number: the producer makes it odd while it updates a counter
+// and even again afterwards, and the consumer retries a read that saw an odd or
+// changed sequence. The interrupt never waits on the main loop, and the main
+// loop only retries if the interrupt fired in the middle of its read. The
+// producer only needs the low 32 bits of the read position to compute the fill
+// level, which it reads with a single atomic load.
+template <typename T, int kCapacity, int kMirrorSize = 0>
+class AudioRing {
+ public:
+  static_assert((kCapacity > 0) && ((kCapacity & (kCapacity - 1)) == 0),
+                "AudioRing capacity must be a power of two");
+  static_assert((kMirrorSize >= 0) && (kMirrorSize <= kCapacity),
+                "AudioRing mirror can't be larger than the ring");
+
+  // `in_flight` is how many samples past the write position the producer may
+  // be overwriting before it publishes them, such as the blocks a DMA engine
+  // is filling. Those can't be read, so they're excluded from the history.
+  explicit AudioRing(int in_flight = 0) : in_flight_(in_flight) {}
+
+  static constexpr int capacity() { return kCapacity; }
+
+  // Samples older than the write position that are still intact.
+  uint32_t history() const { return kCapacity - in_flight_; }
+
+  // Producer side -------------------------------------------------------------
+
+  // Storage a DMA engine can write into directly, followed by Commit().
+  T* data() { return buffer_; }
+
+  // Publishes `count` samples that were written into data() at the current
+  // write position.
+  void Commit(int count) {
+    const uint64_t write = write_position_.Load();
+    Mirror(write, count);
+    const uint64_t new_write = write + count;
+    // Unsigned 32-bit arithmetic stays correct across the low word wrapping,
+    // as the fill level never comes near 2^32.
+    const uint32_t fill = static_cast<uint32_t>(new_write) -
+                          read_position_low_.load(std::memory_order_relaxed);
+    if (fill > history()) {
+      overruns_.store(overruns_.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+    }
+    if (fill > high_water_.load(std::memory_order_relaxed)) {
+      high_water_.store(fill, std::memory_order_relaxed);
+    }
+    // Releases the samples (and mirror) along with the new position.
+    write_position_.Store(new_write);
+  }
+
+  // Copies `count` samples in at the write position and publishes them.
+  void Write(const T* samples, int count) {
+    const uint64_t write = write_position_.Load();
+    for (int i = 0; i < count; ++i) {
+      buffer_[(write + i) & kIndexMask] = samples[i];
+    }
+    Commit(count);
+  }
+
+  // Consumer side -------------------------------------------------------------
+
+  // Number of samples written since capture started.
+  uint64_t write_position() const { return write_position_.Load(); }
+
+  // Sets `samples` to a view of the ring starting at sample `start`, which is
+  // contiguous for kMirrorSize samples (or up to the end of the ring). Returns
+  // false, and counts a stale read, if the samples from `start` have already
+  // been overwritten; the view is still set so callers can carry on.
+  bool Peek(uint64_t start, const T** samples) {
+    *samples = buffer_ + (start & kIndexMask);
+    if (IsIntact(start)) {
+      return true;
+    }
+    stale_reads_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // How many samples from `start` on a view from Peek() holds contiguously:
+  // up to the end of the storage and on through the mirror.
+  static int ContiguousCount(uint64_t start) {
+    return kCapacity + kMirrorSize - static_cast<int>(start & kIndexMask);
+  }
+
+  // Whether the samples from `start` onwards still hold what was captured.
+  // Checking this again after using a view from Peek() catches the producer
+  // overwriting it in the meantime.
+  bool IsIntact(uint64_t start) const {
+    const uint64_t write = write_position_.Load();
+    return (write < history()) || (start >= write - history());
+  }
+
+  // Tells the producer the consumer no longer needs anything before `start`.
+  // Never moves backwards.
+  void Consume(uint64_t start) {
+    if (start <= read_position_) {
+      return;
+    }
+    read_position_ = start;
+    read_position_low_.store(static_cast<uint32_t>(start),
+                             std::memory_order_relaxed);
+  }
+
+  uint64_t read_position() const { return read_position_; }
+
+  // Times the producer wrote over samples the consumer hadn't consumed.
+  uint32_t overruns() const {
+    return overruns_.load(std::memory_order_relaxed);
+  }
+
+  // Times the consumer asked for samples that had already been overwritten.
+  uint32_t stale_reads() const {
+    return stale_reads_.load(std::memory_order_relaxed);
+  }
+
+  // The most samples ever waiting between the read and write positions.
+  uint32_t high_water() const {
+    return high_water_.load(std::memory_order_relaxed);
+  }
+
+  // Clears the ring and its counters. Only safe while the producer is stopped.
+  void Reset() {
+    for (int i = 0; i < kCapacity + kMirrorSize; ++i) {
+      buffer_[i] = 0;
+    }
+    write_position_.Store(0);
+    read_position_ = 0;
+    read_position_low_.store(0, std::memory_order_relaxed);
+    overruns_.store(0, std::memory_order_relaxed);
+    stale_reads_.store(0, std::memory_order_relaxed);
+    high_water_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr uint64_t kIndexMask = kCapacity - 1;
+
+  // A 64-bit value with one writer, published with a sequence number.
+  class SequencedCounter {
+   public:
+    void Store(uint64_t value) {
+      const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+      sequence_.store(sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      low_.store(static_cast<uint32_t>(value), std::memory_order_relaxed);
+      high_.store(static_cast<uint32_t>(value >> 32),
+                  std::memory_order_relaxed);
+      sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    uint64_t Load() const {
+      while (true) {
+        const uint32_t before = sequence_.load(std::memory_order_acquire);
+        const uint32_t low = low_.load(std::memory_order_relaxed);
+        const uint32_t high = high_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint32_t after = sequence_.load(std::memory_order_relaxed);
+        if (((before & 1) == 0) && (before == after)) {
+          return (static_cast<uint64_t>(high) << 32) | low;
+        }
+      }
+    }
+
+   private:
+    std::atomic<uint32_t> sequence_{0};
+    std::atomic<uint32_t> low_{0};
+    std::atomic<uint32_t> high_{0};
+  };
+
+  // Copies the part of [position, position + count) that lands in the head of
+  // the ring to the mirror after its end.
+  void Mirror(uint64_t position, int count) {
+    int index = position & kIndexMask;
+    while (count > 0) {
+      const int run = (count < kCapacity - index) ? count : kCapacity - index;
+      for (int i = index; (i < index + run) && (i < kMirrorSize); ++i) {
+        buffer_[kCapacity + i] = buffer_[i];
+      }
+      count -= run;
+      index = 0;
+    }
+  }
+
+  // Word aligned, so blocks of 16-bit samples can be processed in pairs.
+  alignas(T) alignas(4) T buffer_[kCapacity + kMirrorSize] = {};
+  const uint32_t in_flight_;
+  SequencedCounter write_position_;
+  // Only touched by the consumer.
+  uint64_t read_position_ = 0;
+  // The low word of read_position_, for the producer.
+  std::atomic<uint32_t> read_position_low_{0};
+  std::atomic<uint32_t> overruns_{0};
+  std::atomic<uint32_t> stale_reads_{0};
+  std::atomic<uint32_t> high_water_{0};
+};
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_AUDIO_RING_H_
@@ -0,0 +1,237 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_AUDIO_SOURCE_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_AUDIO_SOURCE_H_
+
+#include <cstdint>
+
+#include "audio_ring.h"
+#include "idle_meter.h"
+#include "micro_features_micro_model_settings.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/micro/micro_log.h"
+
+// Health of the buffer between the audio capture and the main loop.
+struct AudioCaptureStats {
+  // Samples captured since recording started.
+  uint64_t samples_captured;
+  // Blocks written over audio that hadn't been processed yet.
+  uint32_t overruns;
+  // Reads of audio that had already been overwritten. Features computed from
+  // those didn't come from the audio they were meant to.
+  uint32_t stale_reads;
+  // The most samples ever waiting to be processed.
+  uint32_t high_water;
+  // How many samples can be waiting before they're overwritten.
+  uint32_t capacity;
+};
+
+// This is an abstraction around an audio source like a microphone. Code that
+// consumes audio, like FeatureProvider and the sketch's loop(), is a template
+// over the source type, so the source is picked at compile time and every call
+// is a direct one; there are no virtual functions. Each source derives from
+// AudioSource<Itself> (the curiously recurring template pattern), which
+// provides the interface below on top of the capture ring the source fills:
+//
+//   TfLiteStatus Init();
+//     Starts capture, and doesn't return until the first block has arrived.
+//   int64_t LatestSampleCount();
+//     How many samples have been captured since recording started, which is
+//     the pipeline's clock. It's 64 bits wide so it doesn't wrap (it would take
+//     millions of years at 16kHz) and, being a count of samples rather than a
+//     rounded duration, it never drifts from the audio itself. Subsequent calls
+//     never return a lower value.
+//   TfLiteStatus GetSamples(int64_t start_sample, int sample_count,
+//                           int* audio_samples_size,
+//                           const int16_t** audio_samples);
+//     Returns 16-bit PCM sample data for a point on that clock. The samples
+//     are a read-only view straight into the capture ring, at most
+//     kMaxAudioSampleSize long, and should be used as quickly as possible by
+//     the caller, since there are no guarantees that they won't be overwritten
+//     by new data in the future. In practice the ring holds about a second of
+//     audio, and any read of audio that was already overwritten is counted and
+//     reported.
+//   TfLiteStatus PeekSamples(int64_t start_sample, int sample_count,
+//                            int* audio_samples_size,
+//                            const int16_t** audio_samples);
+//   void ReleaseSamples(int64_t start_sample);
+//     GetSamples() is these two together. PeekSamples() reads without telling
+//     the capture that anything before `start_sample` is done with, for code
+//     like the voice activity detector that looks ahead of the features;
+//     ReleaseSamples() says that nothing before `start_sample` will be read
+//     again, so the capture only counts overruns of audio still needed.
+//   TfLiteStatus PeekContiguousSamples(int64_t start_sample, int max_count,
+//                                      int* audio_samples_size,
+//                                      const int16_t** audio_samples);
+//     Like PeekSamples(), but for as many of the next `max_count` samples as
+//     the ring holds in one run from `start_sample`, which is at least
+//     kMaxAudioSampleSize and up to the whole ring, for code that catches up
+//     on a long stretch of audio at once. `audio_samples_size` is set to how
+//     many that is.
+//   void GetStats(AudioCaptureStats* stats);
+//     The capture ring's overrun and fill-level counters.
+//   void WaitForSamples(int64_t sample_count);
+//     Sleeps until more than `sample_count` samples have been captured, so
+//     the main loop can wait for the next block instead of spinning on
+//     LatestSampleCount().
+//   const IdleMeter& idle_meter() const;
+//     How much of the time since Init() was spent in WaitForSamples().
+//
+// A source implements these, which AudioSource calls through the derived type:
+//
+//   TfLiteStatus StartCapture();
+//     Starts its hardware or stream. Called by Init().
+//   int64_t Capture();
+//     Called by LatestSampleCount() to return the sample count. Sources driven
+//     by an interrupt can rely on the default, which just reads the ring;
+//     sources that produce audio on demand capture more here first.
+//   void WaitForCapture(int64_t sample_count);
+//     Returns once the ring's write position is past `sample_count`, sleeping
+//     until the producer signals that it has published a block. Sources that
+//     produce audio on demand return straight away.
+//
+// and fill the ring with ring().Commit() or ring().Write(), usually from an
+// interrupt handler.
+//
+// The sources are:
+//   SaadcAudioSource (saadc_audio_source.h): an analog microphone on the nRF52
+//     SAADC, sampled by a timer through the PPI and written by EasyDMA.
+//   PdmAudioSource (pdm_audio_source.h): a PDM microphone through the Arduino
+//     PDM library, like the one on the Nano 33 BLE Sense.
+//   WavAudioSource, RawStreamAudioSource and SyntheticAudioSource
+//     (host/host_audio_sources.h): a WAV file, raw PCM from stdin or any other
+//     stream, and a generated tone or noise, for running on a Linux host.
+// sketch_audio_source.h picks the one the sketch is built with.
+
+// Samples the capture ring holds, about a second at 16kHz.
+constexpr int kAudioCaptureBufferSize = 512 * 32;
+
+template <typename Derived>
+class AudioSource {
+ public:
+  // The head of the ring is mirrored after its end so that reads of up to
+  // kMaxAudioSampleSize samples never have to wrap.
+  using Ring = AudioRing<int16_t, kAudioCaptureBufferSize, kMaxAudioSampleSize>;
+
+  TfLiteStatus Init() {
+    if (is_started_) {
+      return kTfLiteOk;
+    }
+    TfLiteStatus status = derived()->StartCapture();
+    is_started_ = (status == kTfLiteOk);
+    if (is_started_) {
+      idle_meter_.Start();
+    }
+    return status;
+  }
+
+  int64_t LatestSampleCount() { return derived()->Capture(); }
+
+  TfLiteStatus GetSamples(int64_t start_sample, int sample_count,
+                          int* audio_samples_size,
+                          const int16_t** audio_samples) {
+    // This next part should only be called when the main thread notices that
+    // the latest sample count has changed, so that there's new data in the
+    // capture ring buffer. The ring buffer will eventually wrap around and
+    // overwrite the data if the main thread falls more than about a second
+    // behind; the ring counts every time that happens, and it's reported here.
+    TfLiteStatus status = PeekSamples(start_sample, sample_count,
+                                      audio_samples_size, audio_samples);
+    if (status == kTfLiteOk) {
+      // Nothing before this window will be asked for again, so the producer
+      // is free to reuse it.
+      ReleaseSamples(start_sample);
+    }
+    return status;
+  }
+
+  TfLiteStatus PeekSamples(int64_t start_sample, int sample_count,
+                           int* audio_samples_size,
+                           const int16_t** audio_samples) {
+    if ((start_sample < 0) || (sample_count > kMaxAudioSampleSize)) {
+      MicroPrintf("Can't read %d samples at once, the limit is %d",
+                  sample_count, kMaxAudioSampleSize);
+      return kTfLiteError;
+    }
+    // A read that runs past the end of the ring continues into the mirror, so
+    // the view never has to wrap.
+    PeekView(start_sample, audio_samples);
+    *audio_samples_size = sample_count;
+    return kTfLiteOk;
+  }
+
+  TfLiteStatus PeekContiguousSamples(int64_t start_sample, int max_count,
+                                     int* audio_samples_size,
+                                     const int16_t** audio_samples) {
+    if (start_sample < 0) {
+      MicroPrintf("Can't read audio from before capture started");
+      return kTfLiteError;
+    }
+    const int contiguous = Ring::ContiguousCount(start_sample);
+    PeekView(start_sample, audio_samples);
+    *audio_samples_size = (max_count < contiguous) ? max_count : contiguous;
+    return kTfLiteOk;
+  }
+
+  void ReleaseSamples(int64_t start_sample) { ring_.Consume(start_sample); }
+
+  void GetStats(AudioCaptureStats* stats) const {
+    stats->samples_captured = ring_.write_position();
+    stats->overruns = ring_.overruns();
+    stats->stale_reads = ring_.stale_reads();
+    stats->high_water = ring_.high_water();
+    stats->capacity = ring_.history();
+  }
+
+  void WaitForSamples(int64_t sample_count) {
+    idle_meter_.BeginIdle();
+    derived()->WaitForCapture(sample_count);
+    idle_meter_.EndIdle();
+  }
+
+  const IdleMeter& idle_meter() const { return idle_meter_; }
+
+  // Default for sources that are filled by an interrupt.
+  int64_t Capture() { return ring_.write_position(); }
+
+ protected:
+  // `in_flight` is how many samples the producer may be writing ahead of what
+  // it has published, see AudioRing.
+  explicit AudioSource(int in_flight = 0) : ring_(in_flight) {}
+
+  Ring& ring() { return ring_; }
+  const Ring& ring() const { return ring_; }
+
+  bool is_started() const { return is_started_; }
+  // Lets a source that is rewound to the beginning be started again.
+  void set_started(bool is_started) { is_started_ = is_started; }
+
+ private:
+  Derived* derived() { return static_cast<Derived*>(this); }
+
+  void PeekView(int64_t start_sample, const int16_t** audio_samples) {
+    if (!ring_.Peek(start_sample, audio_samples)) {
+      MicroPrintf("Audio at %ds was overwritten before it was processed",
+                  static_cast<int>(start_sample / kAudioSampleFrequency));
+    }
+  }
+
+  Ring ring_;
+  bool is_started_ = false;
+  IdleMeter idle_meter_;
+};
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_AUDIO_SOURCE_H_
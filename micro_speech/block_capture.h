@@ -0,0 +1,95 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_BLOCK_CAPTURE_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_BLOCK_CAPTURE_H_
+
+#include <cstdint>
+
+// Drives a DMA-capable ADC so that it writes straight into consecutive blocks
+// of a capture ring buffer, taking one interrupt per block instead of one per
+// sample.
+//
+// Peripherals like the nRF52 SAADC double-buffer their DMA pointer: the
+// pointer written before a START task is latched when the STARTED event fires,
+// after which the next pointer can be written while the current block fills.
+// When the block is full the peripheral raises END, and (with END wired to
+// START) immediately latches the next pointer and carries on. So the
+// interrupt handler calls OnEnd() to collect the finished block and
+// OnStarted() to queue the block after the one now filling.
+//
+// `Hal` is the small hardware interface this needs:
+//   void SetBuffer(int16_t* buffer, uint32_t sample_count);
+//     Sets the DMA pointer and length the next START latches.
+//   void Start();
+//     Triggers the first START task.
+// SaadcAudioSource implements it for the SAADC, and the host build
+// uses a simulated peripheral so the same logic runs off the device.
+template <typename Hal>
+class BlockCapture {
+ public:
+  // `ring` holds `block_count` blocks of `block_size` samples each.
+  BlockCapture(Hal* hal, int16_t* ring, int block_size, int block_count)
+      : hal_(hal),
+        ring_(ring),
+        block_size_(block_size),
+        block_count_(block_count),
+        filling_block_(0),
+        next_block_(0),
+        blocks_completed_(0) {}
+
+  // Points the peripheral at the first block and starts it.
+  void Start() {
+    filling_block_ = 0;
+    next_block_ = 1 % block_count_;
+    blocks_completed_ = 0;
+    hal_->SetBuffer(BlockAt(0), block_size_);
+    hal_->Start();
+  }
+
+  // Call from the interrupt handler on STARTED: the peripheral has latched the
+  // block it's filling now, so queue up the one after it.
+  void OnStarted() {
+    hal_->SetBuffer(BlockAt(next_block_), block_size_);
+    next_block_ = (next_block_ + 1) % block_count_;
+  }
+
+  // Call from the interrupt handler on END. Returns the index of the block
+  // that was just filled.
+  int OnEnd() {
+    const int completed = filling_block_;
+    filling_block_ = (filling_block_ + 1) % block_count_;
+    blocks_completed_ += 1;
+    return completed;
+  }
+
+  // Number of blocks filled since Start().
+  uint32_t blocks_completed() const { return blocks_completed_; }
+
+  int16_t* BlockAt(int block) { return ring_ + (block * block_size_); }
+
+ private:
+  Hal* hal_;
+  int16_t* ring_;
+  const int block_size_;
+  const int block_count_;
+  // Block the peripheral is writing into now.
+  int filling_block_;
+  // Block to hand to the peripheral on the next STARTED event.
+  int next_block_;
+  volatile uint32_t blocks_completed_;
+};
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_BLOCK_CAPTURE_H_
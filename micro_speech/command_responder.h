@@ -23,8 +23,9 @@ limitations under the License.
 // Called every time the results of an audio recognition run are available. The
 // human-readable name of any recognized command is in the `found_command`
 // argument, `score` has the numerical confidence, and `is_new_command` is set
-// if the previous command was different to this one.
-void RespondToCommand(int32_t current_time, const char* found_command,
+// if the previous command was different to this one. `current_time_ms` is the
+// audio clock in milliseconds, which doesn't wrap.
+void RespondToCommand(int64_t current_time_ms, const char* found_command,
                       uint8_t score, bool is_new_command);
 
 #endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_COMMAND_RESPONDER_H_
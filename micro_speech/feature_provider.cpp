@@ -15,112 +15,53 @@ limitations under the License.
 
 #include "feature_provider.h"
 
-#include "audio_provider.h"
-#include "micro_features_micro_features_generator.h"
+#include <cstring>
+
 #include "micro_features_micro_model_settings.h"
-#include "tensorflow/lite/micro/micro_log.h"
 
-FeatureProvider::FeatureProvider(int feature_size, int8_t* feature_data)
-    : feature_size_(feature_size),
-      feature_data_(feature_data),
-      is_first_run_(true) {
-  // Initialize the feature data to default values.
-  for (int n = 0; n < feature_size_; ++n) {
-    feature_data_[n] = 0;
+template <typename Settings>
+int NewFeatureSlicesAvailable(int64_t last_sample, int64_t current_sample) {
+  constexpr int kFeatureSliceStrideSamples =
+      Settings::kFeatureSliceStrideSamples;
+  constexpr int kFeatureSliceDurationSamples =
+      Settings::kFeatureSliceDurationSamples;
+  // A slice starting at `last_sample` needs samples up to
+  // last_sample + kFeatureSliceDurationSamples, and each later one another
+  // stride's worth.
+  const int64_t available_samples = current_sample - last_sample;
+  if (available_samples < kFeatureSliceDurationSamples) {
+    return 0;
   }
+  return static_cast<int>(
+      ((available_samples - kFeatureSliceDurationSamples) /
+       kFeatureSliceStrideSamples) +
+      1);
 }
 
-FeatureProvider::~FeatureProvider() {}
-
-TfLiteStatus FeatureProvider::PopulateFeatureData(int32_t last_time_in_ms,
-                                                  int32_t time_in_ms,
-                                                  int* how_many_new_slices) {
-  if (feature_size_ != kFeatureElementCount) {
-    MicroPrintf("Requested feature_data_ size %d doesn't match %d",
-                feature_size_, kFeatureElementCount);
-    return kTfLiteError;
-  }
-
-  // Quantize the time into steps as long as each window stride, so we can
-  // figure out which audio data we need to fetch.
-  const int last_step = (last_time_in_ms / kFeatureSliceStrideMs);
-  // Number of new 20ms slices from which we can take 30ms samples
-  int slices_needed =
-      ((((time_in_ms - last_time_in_ms) - kFeatureSliceDurationMs) *
-        kFeatureSliceStrideMs) /
-           kFeatureSliceStrideMs +
-       kFeatureSliceStrideMs) /
-      kFeatureSliceStrideMs;
-  // If this is the first call, make sure we don't use any cached information.
-  if (is_first_run_) {
-    TfLiteStatus init_status = InitializeMicroFeatures();
-    if (init_status != kTfLiteOk) {
-      return init_status;
-    }
-    is_first_run_ = false;
-    return kTfLiteOk;
-  }
-  if (slices_needed > kFeatureSliceCount) {
-    slices_needed = kFeatureSliceCount;
-  }
-  if (slices_needed == 0) {
-    return kTfLiteOk;
-  }
-  *how_many_new_slices = slices_needed;
-
-  const int slices_to_keep = kFeatureSliceCount - slices_needed;
-  const int slices_to_drop = kFeatureSliceCount - slices_to_keep;
-  // If we can avoid recalculating some slices, just move the existing data
-  // up in the spectrogram, to perform something like this:
-  // last time = 80ms          current time = 120ms
-  // +-----------+             +-----------+
-  // | data@20ms |         --> | data@60ms |
-  // +-----------+       --    +-----------+
-  // | data@40ms |     --  --> | data@80ms |
-  // +-----------+   --  --    +-----------+
-  // | data@60ms | --  --      |  <empty>  |
-  // +-----------+   --        +-----------+
-  // | data@80ms | --          |  <empty>  |
-  // +-----------+             +-----------+
-  if (slices_to_keep > 0) {
-    for (int dest_slice = 0; dest_slice < slices_to_keep; ++dest_slice) {
-      int8_t* dest_slice_data =
-          feature_data_ + (dest_slice * kFeatureSliceSize);
-      const int src_slice = dest_slice + slices_to_drop;
-      const int8_t* src_slice_data =
-          feature_data_ + (src_slice * kFeatureSliceSize);
-      for (int i = 0; i < kFeatureSliceSize; ++i) {
-        dest_slice_data[i] = src_slice_data[i];
-      }
-    }
-  }
-  // Any slices that need to be filled in with feature data have their
-  // appropriate audio data pulled, and features calculated for that slice.
-  if (slices_needed > 0) {
-    for (int new_slice = slices_to_keep; new_slice < kFeatureSliceCount;
-         ++new_slice) {
-      const int new_step = last_step + (new_slice - slices_to_keep);
-      const int32_t slice_start_ms = (new_step * kFeatureSliceStrideMs);
-      int16_t* audio_samples = nullptr;
-      int audio_samples_size = 0;
-      GetAudioSamples(slice_start_ms, kFeatureSliceDurationMs,
-                      &audio_samples_size, &audio_samples);
-      constexpr int wanted =
-          kFeatureSliceDurationMs * (kAudioSampleFrequency / 1000);
-      if (audio_samples_size != wanted) {
-        MicroPrintf("Audio data size %d too small, want %d", audio_samples_size,
-                    wanted);
-        return kTfLiteError;
-      }
-      int8_t* new_slice_data = feature_data_ + (new_slice * kFeatureSliceSize);
-      size_t num_samples_read;
-      TfLiteStatus generate_status = GenerateMicroFeatures(
-          audio_samples, audio_samples_size, kFeatureSliceSize, new_slice_data,
-          &num_samples_read);
-      if (generate_status != kTfLiteOk) {
-        return generate_status;
-      }
-    }
-  }
-  return kTfLiteOk;
+template <typename Settings>
+void CopyFeatureSlices(const int8_t* feature_ring, int oldest_slice,
+                       int8_t* destination) {
+  constexpr int kFeatureSliceSize = Settings::kFeatureSliceSize;
+  constexpr int kFeatureSliceCount = Settings::kFeatureSliceCount;
+  // The slices from the oldest to the end of the ring come first, then the
+  // ones that wrapped around to its start, for example with oldest_slice 2:
+  //   ring         | 100ms | 120ms |  40ms |  60ms |  80ms |
+  //   destination  |  40ms |  60ms |  80ms | 100ms | 120ms |
+  //                <------ first copy ----><--- second --->
+  const int older_bytes =
+      (kFeatureSliceCount - oldest_slice) * kFeatureSliceSize;
+  memcpy(destination, feature_ring + (oldest_slice * kFeatureSliceSize),
+         older_bytes);
+  memcpy(destination + older_bytes, feature_ring,
+         oldest_slice * kFeatureSliceSize);
 }
+
+// The configurations the templates above are built for.
+template int NewFeatureSlicesAvailable<DefaultModelSettings>(
+    int64_t last_sample, int64_t current_sample);
+template int NewFeatureSlicesAvailable<LowPowerModelSettings>(
+    int64_t last_sample, int64_t current_sample);
+template void CopyFeatureSlices<DefaultModelSettings>(
+    const int8_t* feature_ring, int oldest_slice, int8_t* destination);
+template void CopyFeatureSlices<LowPowerModelSettings>(
+    const int8_t* feature_ring, int oldest_slice, int8_t* destination);
@@ -16,7 +16,53 @@ limitations under the License.
 #ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_FEATURE_PROVIDER_H_
 #define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_FEATURE_PROVIDER_H_
 
+#include <cstdint>
+
+#include "micro_features_micro_features_generator.h"
+#include "micro_features_micro_model_settings.h"
 #include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/micro/micro_log.h"
+
+// These helpers, like FeatureProvider, work in the sizes of a pipeline
+// configuration, `Settings` (see ModelSettings). They're built for
+// DefaultModelSettings and LowPowerModelSettings.
+
+// How many new feature slices have their whole window captured between
+// `last_sample` and `current_sample`. Slices start every
+// kFeatureSliceStrideSamples from `last_sample`, and each needs
+// kFeatureSliceDurationSamples of audio.
+template <typename Settings = DefaultModelSettings>
+int NewFeatureSlicesAvailable(int64_t last_sample, int64_t current_sample);
+
+// Copies a window of kFeatureSliceCount slices held as a ring, with its oldest
+// slice at `oldest_slice`, to `destination` in time order. That takes at most
+// two copies, however far the ring has turned.
+template <typename Settings = DefaultModelSettings>
+void CopyFeatureSlices(const int8_t* feature_ring, int oldest_slice,
+                       int8_t* destination);
+
+// How FeatureProvider hands the audio to the frontend.
+enum FeatureFeed {
+  // Each slice's whole 30ms window is handed over separately. The frontend
+  // keeps the last 10ms of every window for the start of the next one and
+  // only takes the first 20ms of the next window offered, so every window
+  // after the first repeats 10ms of audio and misses the last 10ms.
+  kFeatureFeedWindows,
+  // The audio is pushed in as it arrives, each sample once, and a slice is
+  // made whenever the frontend completes a window, as the training pipeline's
+  // frontend does.
+  kFeatureFeedStream,
+};
+
+// What a FeatureProvider has learnt from the audio so far, for carrying it
+// over a reset (see pipeline_snapshot.h): the frontend's noise estimates and
+// the spectrogram, oldest slice first. Audio the frontend was holding towards
+// its next slice isn't kept; that window starts over.
+template <typename Settings = DefaultModelSettings>
+struct FeatureProviderSnapshot {
+  uint32_t noise_estimates[Settings::kFeatureSliceSize];
+  int8_t features[Settings::kFeatureElementCount];
+};
 
 // Binds itself to an area of memory intended to hold the input features for an
 // audio-recognition neural network model, and fills that data area with the
@@ -24,27 +70,280 @@ limitations under the License.
 // The audio features themselves are a two-dimensional array, made up of
 // horizontal slices representing the frequencies at one point in time, stacked
 // on top of each other to form a spectrogram showing how those frequencies
-// changed over time.
+// changed over time. `AudioSource` is the type of the source the audio comes
+// from, see audio_source.h, and `Settings` the pipeline configuration, see
+// ModelSettings, whose sample rate the source must capture at.
+//
+// The data area is a ring of slices rather than a spectrogram in time order:
+// each new slice overwrites the oldest one, so nothing is moved as the window
+// slides. CopyFeatureData() lays it out in time order for the model. The audio
+// reaches the frontend as `feed` says, see FeatureFeed.
+template <typename AudioSource, typename Settings = DefaultModelSettings>
 class FeatureProvider {
+  static constexpr int kFeatureSliceSize = Settings::kFeatureSliceSize;
+  static constexpr int kFeatureSliceCount = Settings::kFeatureSliceCount;
+  static constexpr int kFeatureElementCount = Settings::kFeatureElementCount;
+  static constexpr int kFeatureSliceStrideSamples =
+      Settings::kFeatureSliceStrideSamples;
+  static constexpr int kFeatureSliceDurationSamples =
+      Settings::kFeatureSliceDurationSamples;
+  static_assert(kFeatureSliceDurationSamples <= kMaxAudioSampleSize,
+                "A slice's window must fit in one view of the capture ring");
+
  public:
-  // Create the provider, and bind it to an area of memory. This memory should
-  // remain accessible for the lifetime of the provider object, since subsequent
-  // calls will fill it with feature data. The provider does no memory
-  // management of this data.
-  FeatureProvider(int feature_size, int8_t* feature_data);
-  ~FeatureProvider();
+  // Create the provider, reading audio from `audio_source`, and bind it to an
+  // area of memory. This memory should remain accessible for the lifetime of
+  // the provider object, since subsequent calls will fill it with feature data.
+  // The provider does no memory management of this data. Features are
+  // generated with `context`, or the shared default context if it's null; a
+  // context must only be used by one provider at a time.
+  FeatureProvider(AudioSource* audio_source, int feature_size,
+                  int8_t* feature_data, MicroFeaturesContext* context = nullptr,
+                  FeatureFeed feed = kFeatureFeedWindows)
+      : audio_source_(audio_source),
+        feature_size_(feature_size),
+        feature_data_(feature_data),
+        context_(context != nullptr ? context : DefaultMicroFeaturesContext()),
+        feed_(feed),
+        oldest_slice_(0),
+        window_start_(-1),
+        next_feed_sample_(0),
+        is_first_run_(true) {
+    // Initialize the feature data to default values.
+    for (int n = 0; n < feature_size_; ++n) {
+      feature_data_[n] = 0;
+    }
+  }
 
   // Fills the feature data with information from audio inputs, and returns how
-  // many feature slices were updated.
-  TfLiteStatus PopulateFeatureData(int32_t last_time_in_ms, int32_t time_in_ms,
+  // many feature slices were updated. Times are positions on the audio sample
+  // clock (see AudioSource::LatestSampleCount()): `last_sample` is where the
+  // next slice starts, a multiple of kFeatureSliceStrideSamples, and
+  // `current_sample` is how much audio has been captured. Every slice that fits
+  // entirely before `current_sample` is computed, so the caller should advance
+  // `last_sample` by `how_many_new_slices` strides.
+  // If the caller has fallen more than a whole window behind, only the newest
+  // kFeatureSliceCount slices are computed, since the rest would be dropped
+  // from the window straight away, but `how_many_new_slices` still counts
+  // them all.
+  // With kFeatureFeedStream, audio that doesn't complete a slice yet is pushed
+  // into the frontend too, and if `last_sample` isn't where the frontend's
+  // window started, for example because the caller skipped some audio, the
+  // window starts over from there.
+  TfLiteStatus PopulateFeatureData(int64_t last_sample, int64_t current_sample,
                                    int* how_many_new_slices);
 
+  // Writes the spectrogram to `destination`, kFeatureElementCount bytes, oldest
+  // slice first.
+  void CopyFeatureData(int8_t* destination) const {
+    CopyFeatureSlices<Settings>(feature_data_, oldest_slice_, destination);
+  }
+
+  // Zeroes the spectrogram, as it was when the provider was created, for when
+  // the slices in it are from too long ago to be worth keeping. The frontend's
+  // noise estimates are kept.
+  void ClearFeatureData() {
+    for (int n = 0; n < feature_size_; ++n) {
+      feature_data_[n] = 0;
+    }
+    oldest_slice_ = 0;
+  }
+
+  // Copies the noise estimates and the spectrogram into `snapshot`. Before the
+  // frontend has been set up, its estimates are all 0.
+  void SaveState(FeatureProviderSnapshot<Settings>* snapshot) const;
+
+  // Puts back the state SaveState() saved, setting the frontend up first if
+  // it hasn't been, so the next PopulateFeatureData() carries on from it
+  // rather than from silence.
+  TfLiteStatus RestoreState(const FeatureProviderSnapshot<Settings>& snapshot);
+
+  // The data of slice `index` of the window, from 0 for the oldest to
+  // kFeatureSliceCount - 1 for the newest.
+  const int8_t* SliceData(int index) const {
+    const int slice = (oldest_slice_ + index) % kFeatureSliceCount;
+    return feature_data_ + (slice * kFeatureSliceSize);
+  }
+
  private:
+  // Pushes the audio from next_feed_sample_ up to `current_sample` into the
+  // frontend, starting a new window at `slice_start` unless that's where the
+  // current one started, and writes the `slice_count` slices it completes.
+  TfLiteStatus StreamFeatureSlices(int64_t slice_start, int64_t current_sample,
+                                   int slice_count);
+
+  AudioSource* audio_source_;
   int feature_size_;
   int8_t* feature_data_;
+  MicroFeaturesContext* context_;
+  FeatureFeed feed_;
+  // Where in the ring of slices the oldest one is, and so where the next new
+  // one goes.
+  int oldest_slice_;
+  // With kFeatureFeedStream, the frontend holds the samples from
+  // window_start_ up to next_feed_sample_ towards its next window. -1 before
+  // anything has been pushed.
+  int64_t window_start_;
+  int64_t next_feed_sample_;
   // Make sure we don't try to use cached information if this is the first call
   // into the provider.
   bool is_first_run_;
 };
 
+template <typename AudioSource, typename Settings>
+TfLiteStatus FeatureProvider<AudioSource, Settings>::PopulateFeatureData(
+    int64_t last_sample, int64_t current_sample, int* how_many_new_slices) {
+  if (feature_size_ != kFeatureElementCount) {
+    MicroPrintf("Requested feature_data_ size %d doesn't match %d",
+                feature_size_, kFeatureElementCount);
+    return kTfLiteError;
+  }
+
+  // If this is the first call, make sure we don't use any cached information.
+  if (is_first_run_) {
+    TfLiteStatus init_status = InitializeMicroFeatures<Settings>(context_);
+    if (init_status != kTfLiteOk) {
+      return init_status;
+    }
+    is_first_run_ = false;
+    return kTfLiteOk;
+  }
+  const int slices_available =
+      NewFeatureSlicesAvailable<Settings>(last_sample, current_sample);
+  *how_many_new_slices = slices_available;
+  if ((slices_available == 0) && (feed_ == kFeatureFeedWindows)) {
+    return kTfLiteOk;
+  }
+
+  // Slices older than a whole window wouldn't survive this call, so skip
+  // straight past them.
+  const int slices_to_compute = (slices_available < kFeatureSliceCount)
+                                    ? slices_available
+                                    : kFeatureSliceCount;
+  int64_t slice_start =
+      last_sample + static_cast<int64_t>(slices_available - slices_to_compute) *
+                        kFeatureSliceStrideSamples;
+  if (feed_ == kFeatureFeedStream) {
+    return StreamFeatureSlices(slice_start, current_sample, slices_to_compute);
+  }
+  // Each new slice has its audio data pulled and its features calculated
+  // straight into the ring, in place of the oldest slice.
+  for (int i = 0; i < slices_to_compute; ++i) {
+    // A view straight into the capture buffer; the frontend only reads it.
+    const int16_t* audio_samples = nullptr;
+    int audio_samples_size = 0;
+    TfLiteStatus audio_status =
+        audio_source_->GetSamples(slice_start, kFeatureSliceDurationSamples,
+                                  &audio_samples_size, &audio_samples);
+    if (audio_status != kTfLiteOk) {
+      return audio_status;
+    }
+    constexpr int wanted = kFeatureSliceDurationSamples;
+    if (audio_samples_size != wanted) {
+      MicroPrintf("Audio data size %d too small, want %d", audio_samples_size,
+                  wanted);
+      return kTfLiteError;
+    }
+    int8_t* new_slice_data =
+        feature_data_ + (oldest_slice_ * kFeatureSliceSize);
+    size_t num_samples_read;
+    TfLiteStatus generate_status = GenerateMicroFeatures<Settings>(
+        context_, audio_samples, audio_samples_size, kFeatureSliceSize,
+        new_slice_data, &num_samples_read);
+    if (generate_status != kTfLiteOk) {
+      return generate_status;
+    }
+    oldest_slice_ = (oldest_slice_ + 1) % kFeatureSliceCount;
+    slice_start += kFeatureSliceStrideSamples;
+  }
+  return kTfLiteOk;
+}
+
+template <typename AudioSource, typename Settings>
+void FeatureProvider<AudioSource, Settings>::SaveState(
+    FeatureProviderSnapshot<Settings>* snapshot) const {
+  if (is_first_run_) {
+    for (int i = 0; i < kFeatureSliceSize; ++i) {
+      snapshot->noise_estimates[i] = 0;
+    }
+  } else {
+    GetMicroFeaturesNoiseEstimates(context_, snapshot->noise_estimates);
+  }
+  CopyFeatureData(snapshot->features);
+}
+
+template <typename AudioSource, typename Settings>
+TfLiteStatus FeatureProvider<AudioSource, Settings>::RestoreState(
+    const FeatureProviderSnapshot<Settings>& snapshot) {
+  if (feature_size_ != kFeatureElementCount) {
+    MicroPrintf("Requested feature_data_ size %d doesn't match %d",
+                feature_size_, kFeatureElementCount);
+    return kTfLiteError;
+  }
+  if (is_first_run_) {
+    TfLiteStatus init_status = InitializeMicroFeatures<Settings>(context_);
+    if (init_status != kTfLiteOk) {
+      return init_status;
+    }
+    is_first_run_ = false;
+  }
+  SetMicroFeaturesNoiseEstimates(context_, snapshot.noise_estimates);
+  // Laid out in time order, which is a ring whose oldest slice is the first.
+  for (int n = 0; n < kFeatureElementCount; ++n) {
+    feature_data_[n] = snapshot.features[n];
+  }
+  oldest_slice_ = 0;
+  // Whatever the frontend held towards its next window is from before the
+  // snapshot.
+  ResetMicroFeaturesWindow(context_);
+  window_start_ = -1;
+  return kTfLiteOk;
+}
+
+template <typename AudioSource, typename Settings>
+TfLiteStatus FeatureProvider<AudioSource, Settings>::StreamFeatureSlices(
+    int64_t slice_start, int64_t current_sample, int slice_count) {
+  if (slice_start != window_start_) {
+    ResetMicroFeaturesWindow(context_);
+    window_start_ = slice_start;
+    next_feed_sample_ = slice_start;
+  }
+  // Everything captured is pushed in as few calls as the ring allows, so a
+  // run of slices the loop has fallen behind on is made in one batch.
+  int slices_done = 0;
+  while (next_feed_sample_ < current_sample) {
+    const int64_t samples_left = current_sample - next_feed_sample_;
+    const int wanted = (samples_left < INT32_MAX)
+                           ? static_cast<int>(samples_left)
+                           : INT32_MAX;
+    const int16_t* audio_samples = nullptr;
+    int audio_samples_size = 0;
+    TfLiteStatus audio_status = audio_source_->PeekContiguousSamples(
+        next_feed_sample_, wanted, &audio_samples_size, &audio_samples);
+    if (audio_status != kTfLiteOk) {
+      return audio_status;
+    }
+    int slices_made = 0;
+    TfLiteStatus generate_status = StreamMicroFeatureSlices<Settings>(
+        context_, audio_samples, audio_samples_size, feature_data_,
+        kFeatureSliceCount, &oldest_slice_, &slices_made);
+    if (generate_status != kTfLiteOk) {
+      return generate_status;
+    }
+    slices_done += slices_made;
+    window_start_ += static_cast<int64_t>(slices_made) *
+                     kFeatureSliceStrideSamples;
+    next_feed_sample_ += audio_samples_size;
+    // The frontend keeps its own copy of what it holds, but the caller may
+    // still start a new window from window_start_.
+    audio_source_->ReleaseSamples(window_start_);
+  }
+  if (slices_done != slice_count) {
+    MicroPrintf("The frontend made %d slices, expected %d", slices_done,
+                slice_count);
+    return kTfLiteError;
+  }
+  return kTfLiteOk;
+}
+
 #endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_FEATURE_PROVIDER_H_
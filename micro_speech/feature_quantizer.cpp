@@ -0,0 +1,176 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "feature_quantizer.h"
+
+#include "tensorflow/lite/experimental/microfrontend/lib/bits.h"
+#include "tensorflow/lite/experimental/microfrontend/lib/log_lut.h"
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+#include <arm_acle.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// The logs are quantized in blocks this size, a whole SSE or NEON register.
+constexpr int kQuantizeBlockSize = 8;
+
+// LogScaleApply()'s private helpers from the frontend's log_scale.c, which
+// aren't exported, so that each log can be quantized as soon as it's made.
+// They must stay bit-identical to the originals.
+uint32_t Log2FractionPart(uint32_t x, uint32_t log2x) {
+  int32_t frac = x - (1LL << log2x);
+  if (log2x < kLogScaleLog2) {
+    frac <<= kLogScaleLog2 - log2x;
+  } else {
+    frac >>= log2x - kLogScaleLog2;
+  }
+  const uint32_t base_seg = frac >> (kLogScaleLog2 - kLogSegmentsLog2);
+  const uint32_t seg_unit = (static_cast<uint32_t>(1) << kLogScaleLog2) >>
+                            kLogSegmentsLog2;
+  const int32_t c0 = kLogLut[base_seg];
+  const int32_t c1 = kLogLut[base_seg + 1];
+  const int32_t seg_base = seg_unit * base_seg;
+  const int32_t rel_pos = ((c1 - c0) * (frac - seg_base)) >> kLogScaleLog2;
+  return frac + c0 + rel_pos;
+}
+
+uint32_t Log(uint32_t x, uint32_t scale_shift) {
+  const uint32_t integer = MostSignificantBit32(x) - 1;
+  const uint32_t fraction = Log2FractionPart(x, integer);
+  const uint32_t log2 = (integer << kLogScaleLog2) + fraction;
+  const uint32_t round = kLogScale / 2;
+  const uint32_t loge =
+      (static_cast<uint64_t>(kLogCoeff) * log2 + round) >> kLogScaleLog2;
+  return ((loge << scale_shift) + round) >> kLogScaleLog2;
+}
+
+// One channel of LogScaleApply().
+uint16_t LogScale(const LogScaleState* state, uint32_t value,
+                  int correction_bits) {
+  if (state->enable_log) {
+    if (correction_bits < 0) {
+      value >>= -correction_bits;
+    } else {
+      value <<= correction_bits;
+    }
+    value = (value > 1) ? Log(value, state->scale_shift) : 0;
+  }
+  return (value < UINT16_MAX) ? value : UINT16_MAX;
+}
+
+}  // namespace
+
+int8_t QuantizeFeatureReference(uint16_t value) {
+  // These scaling values are derived from those used in input_data.py in the
+  // training pipeline; see feature_quantizer.h.
+  constexpr int32_t value_scale = 256;
+  constexpr int32_t value_div = static_cast<int32_t>((25.6f * 26.0f) + 0.5f);
+  int32_t feature = ((value * value_scale) + (value_div / 2)) / value_div;
+  feature -= 128;
+  if (feature < -128) {
+    feature = -128;
+  }
+  if (feature > 127) {
+    feature = 127;
+  }
+  return static_cast<int8_t>(feature);
+}
+
+void QuantizeFeatures(const uint16_t* values, int count, int8_t* output) {
+  int i = 0;
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+  // Both halves of a pair are scaled with one multiply-accumulate each, then
+  // recentred with SSUB16 and clamped to int8 with SSAT16.
+  const uint32_t* pairs = reinterpret_cast<const uint32_t*>(values);
+  for (; i + 1 < count; i += 2) {
+    const uint32_t pair = pairs[i / 2];
+    const uint32_t low =
+        ((pair & 0xffff) * kFeatureQuantizeMultiplier +
+         kFeatureQuantizeOffset) >>
+        kFeatureQuantizeShift;
+    const uint32_t high =
+        ((pair >> 16) * kFeatureQuantizeMultiplier + kFeatureQuantizeOffset) >>
+        kFeatureQuantizeShift;
+    const uint32_t features =
+        __ssat16(__ssub16(low | (high << 16), 0x00800080), 8);
+    output[i] = static_cast<int8_t>(features & 0xff);
+    output[i + 1] = static_cast<int8_t>(features >> 16);
+  }
+#elif defined(__SSE2__)
+  // PMADDWD computes value * multiplier + 1 * offset in each 32-bit lane,
+  // which only works on signed 16-bit values, so anything past 32767 is
+  // clamped to it first; all of those quantize to 127 anyway.
+  const __m128i max_value = _mm_set1_epi16(INT16_MAX);
+  const __m128i ones = _mm_set1_epi16(1);
+  const __m128i coefficients =
+      _mm_set1_epi32((kFeatureQuantizeOffset << 16) |
+                     kFeatureQuantizeMultiplier);
+  const __m128i zero_point = _mm_set1_epi16(128);
+  for (; i + kQuantizeBlockSize <= count; i += kQuantizeBlockSize) {
+    __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+    block = _mm_sub_epi16(block, _mm_subs_epu16(block, max_value));
+    const __m128i low = _mm_srai_epi32(
+        _mm_madd_epi16(_mm_unpacklo_epi16(block, ones), coefficients),
+        kFeatureQuantizeShift);
+    const __m128i high = _mm_srai_epi32(
+        _mm_madd_epi16(_mm_unpackhi_epi16(block, ones), coefficients),
+        kFeatureQuantizeShift);
+    const __m128i scaled =
+        _mm_sub_epi16(_mm_packs_epi32(low, high), zero_point);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(output + i),
+                     _mm_packs_epi16(scaled, scaled));
+  }
+#elif defined(__ARM_NEON)
+  const uint32x4_t offset = vdupq_n_u32(kFeatureQuantizeOffset);
+  const uint16x4_t multiplier = vdup_n_u16(kFeatureQuantizeMultiplier);
+  const int16x8_t zero_point = vdupq_n_s16(128);
+  for (; i + kQuantizeBlockSize <= count; i += kQuantizeBlockSize) {
+    const uint16x8_t block = vld1q_u16(values + i);
+    const uint16x4_t low = vshrn_n_u32(
+        vmlal_u16(offset, vget_low_u16(block), multiplier),
+        kFeatureQuantizeShift);
+    const uint16x4_t high = vshrn_n_u32(
+        vmlal_u16(offset, vget_high_u16(block), multiplier),
+        kFeatureQuantizeShift);
+    const int16x8_t scaled =
+        vsubq_s16(vreinterpretq_s16_u16(vcombine_u16(low, high)), zero_point);
+    vst1_s8(output + i, vqmovn_s16(scaled));
+  }
+#endif
+  for (; i < count; ++i) {
+    output[i] = QuantizeFeature(values[i]);
+  }
+}
+
+void LogScaleAndQuantizeFeatures(const LogScaleState* state,
+                                 const uint32_t* signal, int count,
+                                 int correction_bits, int8_t* output) {
+  alignas(16) uint16_t block[kQuantizeBlockSize];
+  for (int start = 0; start < count; start += kQuantizeBlockSize) {
+    const int size = (count - start < kQuantizeBlockSize)
+                         ? count - start
+                         : kQuantizeBlockSize;
+    for (int i = 0; i < size; ++i) {
+      block[i] = LogScale(state, signal[start + i], correction_bits);
+    }
+    QuantizeFeatures(block, size, output + start);
+  }
+}
@@ -0,0 +1,72 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_FEATURE_QUANTIZER_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_FEATURE_QUANTIZER_H_
+
+#include <cstdint>
+
+#include "tensorflow/lite/experimental/microfrontend/lib/log_scale.h"
+
+// Turns the frontend's log-scaled filterbank energies, roughly 0 to 670, into
+// the int8 features the model was trained on. The training pipeline divides
+// them by 25.6 and quantizes the 0.0 to 26.0 result to -128 to 127, which in
+// integers is
+//
+//   feature = clamp((value * 256 + 333) / 666 - 128, -128, 127)
+//
+// The division is replaced by a multiply by a fixed-point reciprocal:
+//
+//   feature = clamp(((value * 25191 + 32704) >> 16) - 128, -128, 127)
+//
+// 25191 is 256 / 666 in Q16, rounded up, and 32704 is the rounding half
+// (32768) less a little to make up for that. Any offset from 32677 to 32868
+// gives the same results for every uint16 value; this one also fits in an
+// int16, which the SSE version needs. host/pipeline_test checks all 65536
+// values against the division.
+constexpr int32_t kFeatureQuantizeMultiplier = 25191;
+constexpr int32_t kFeatureQuantizeOffset = 32704;
+constexpr int kFeatureQuantizeShift = 16;
+
+// The division, as the original feature generator did it.
+int8_t QuantizeFeatureReference(uint16_t value);
+
+// One value with the reciprocal. value * multiplier + offset stays below 2^31
+// for every uint16 value, so it needs no clamp on the way in.
+inline int8_t QuantizeFeature(uint16_t value) {
+  int32_t feature = ((value * kFeatureQuantizeMultiplier +
+                      kFeatureQuantizeOffset) >>
+                     kFeatureQuantizeShift) -
+                    128;
+  feature = (feature > 127) ? 127 : feature;
+  feature = (feature < -128) ? -128 : feature;
+  return static_cast<int8_t>(feature);
+}
+
+// Quantizes `count` values, eight at a time with SSE2 or NEON on a host, or two
+// at a time with the Cortex-M4's DSP instructions, with the same results as
+// QuantizeFeature(). `values` must be 4-byte aligned.
+void QuantizeFeatures(const uint16_t* values, int count, int8_t* output);
+
+// The frontend's last stage, LogScaleApply(), fused with the quantization:
+// each energy in `signal` is log-scaled exactly as the frontend does and
+// quantized in blocks of eight as soon as it's computed, so the array of
+// uint16 logs is never stored. The results are bit-identical to
+// LogScaleApply() followed by QuantizeFeatureReference().
+void LogScaleAndQuantizeFeatures(const LogScaleState* state,
+                                 const uint32_t* signal, int count,
+                                 int correction_bits, int8_t* output);
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_FEATURE_QUANTIZER_H_
@@ -0,0 +1,2 @@
+// The Arduino TensorFlowLite library exposes this header so the IDE knows to
+// link it into the sketch. The host build links TFLM directly, so it's empty.
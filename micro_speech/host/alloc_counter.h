@@ -0,0 +1,28 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_ALLOC_COUNTER_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_ALLOC_COUNTER_H_
+
+#include <cstdint>
+
+// Counts heap allocations made by the program. C++ allocations are caught by
+// replacing operator new, and C allocations (the audio frontend uses malloc)
+// by linking with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc.
+
+// Number of allocations made since the program started.
+uint64_t AllocationCount();
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_ALLOC_COUNTER_H_
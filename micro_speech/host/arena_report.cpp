@@ -0,0 +1,247 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Measures how much of the tensor arena g_model really needs. It allocates the
+// model's tensors in a deliberately oversized arena with TFLM's recording
+// allocator and reports:
+//  - the total arena bytes used, split into the persistent section (tensor
+//    structs, op data, quantization params) and the non-persistent section
+//    (activations, planned by TFLM's greedy memory planner),
+//  - TFLM's own breakdown of the recorded allocations,
+//  - the lifetime of every activation tensor, as the span of operators from the
+//    one that first writes it to the last one that reads it.
+// With --header_out it writes the measured size plus headroom to a header the
+// sketch includes, so the firmware's arena is never larger than it has to be:
+//
+//   ./build/arena_report --headroom_bytes=512 --header_out=../tensor_arena_size.h
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "micro_features_model.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/micro/recording_micro_interpreter.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "tensorflow/lite/schema/schema_utils.h"
+
+namespace {
+
+// Comfortably larger than any arena this model could need.
+constexpr int kProbeArenaSize = 128 * 1024;
+alignas(16) uint8_t g_probe_arena[kProbeArenaSize];
+
+// TFLM aligns arena allocations to this, so the generated size is too.
+constexpr int kArenaAlignment = 16;
+
+int TensorTypeSize(tflite::TensorType type) {
+  switch (type) {
+    case tflite::TensorType_INT8:
+    case tflite::TensorType_UINT8:
+      return 1;
+    case tflite::TensorType_INT16:
+    case tflite::TensorType_FLOAT16:
+      return 2;
+    case tflite::TensorType_INT32:
+    case tflite::TensorType_FLOAT32:
+      return 4;
+    case tflite::TensorType_INT64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+struct TensorLifetime {
+  int index;
+  int bytes;
+  int first_op;
+  int last_op;
+};
+
+// Prints the first and last operator touching each tensor that isn't backed by
+// constant data in the flatbuffer, and returns the most bytes of them alive
+// during any one operator. That's a lower bound on the non-persistent section.
+int PrintTensorLifetimes(const tflite::Model* model) {
+  const tflite::SubGraph* subgraph = model->subgraphs()->Get(0);
+  const auto* tensors = subgraph->tensors();
+  const auto* operators = subgraph->operators();
+  const int op_count = static_cast<int>(operators->size());
+
+  std::vector<TensorLifetime> lifetimes;
+  for (uint32_t i = 0; i < tensors->size(); ++i) {
+    const tflite::Tensor* tensor = tensors->Get(i);
+    const tflite::Buffer* buffer = model->buffers()->Get(tensor->buffer());
+    if ((buffer->data() != nullptr) && (buffer->data()->size() > 0)) {
+      continue;  // Weights and other constants live in flash.
+    }
+    int bytes = TensorTypeSize(tensor->type());
+    if (tensor->shape() != nullptr) {
+      for (uint32_t d = 0; d < tensor->shape()->size(); ++d) {
+        bytes *= tensor->shape()->Get(d);
+      }
+    }
+    lifetimes.push_back({static_cast<int>(i), bytes, op_count, -1});
+  }
+
+  auto touch = [&lifetimes](int tensor_index, int op) {
+    for (TensorLifetime& lifetime : lifetimes) {
+      if (lifetime.index == tensor_index) {
+        lifetime.first_op = std::min(lifetime.first_op, op);
+        lifetime.last_op = std::max(lifetime.last_op, op);
+      }
+    }
+  };
+  // Graph inputs are live from the start, outputs until the end.
+  for (uint32_t i = 0; i < subgraph->inputs()->size(); ++i) {
+    touch(subgraph->inputs()->Get(i), 0);
+  }
+  for (uint32_t i = 0; i < subgraph->outputs()->size(); ++i) {
+    touch(subgraph->outputs()->Get(i), op_count - 1);
+  }
+  for (int op = 0; op < op_count; ++op) {
+    const tflite::Operator* op_data = operators->Get(op);
+    for (uint32_t i = 0; i < op_data->inputs()->size(); ++i) {
+      touch(op_data->inputs()->Get(i), op);
+    }
+    for (uint32_t i = 0; i < op_data->outputs()->size(); ++i) {
+      touch(op_data->outputs()->Get(i), op);
+    }
+  }
+
+  printf("\nactivation tensor lifetimes\n");
+  printf("%6s  %-40s %8s %6s %6s\n", "tensor", "name", "bytes", "first",
+         "last");
+  for (const TensorLifetime& lifetime : lifetimes) {
+    const tflite::Tensor* tensor = tensors->Get(lifetime.index);
+    printf("%6d  %-40.40s %8d %6d %6d\n", lifetime.index,
+           tensor->name() ? tensor->name()->c_str() : "", lifetime.bytes,
+           lifetime.first_op, lifetime.last_op);
+  }
+
+  printf("\noperators\n");
+  int peak_bytes = 0;
+  for (int op = 0; op < op_count; ++op) {
+    int live_bytes = 0;
+    for (const TensorLifetime& lifetime : lifetimes) {
+      if ((lifetime.first_op <= op) && (op <= lifetime.last_op)) {
+        live_bytes += lifetime.bytes;
+      }
+    }
+    peak_bytes = std::max(peak_bytes, live_bytes);
+    const tflite::OperatorCode* code =
+        model->operator_codes()->Get(operators->Get(op)->opcode_index());
+    printf("%6d  %-24s %8d live activation bytes\n", op,
+           tflite::EnumNameBuiltinOperator(tflite::GetBuiltinCode(code)),
+           live_bytes);
+  }
+  return peak_bytes;
+}
+
+bool WriteHeader(const char* path, int used_bytes, int headroom_bytes) {
+  FILE* file = fopen(path, "w");
+  if (file == nullptr) {
+    fprintf(stderr, "Couldn't write %s\n", path);
+    return false;
+  }
+  const int size = ((used_bytes + headroom_bytes + kArenaAlignment - 1) /
+                    kArenaAlignment) *
+                   kArenaAlignment;
+  fprintf(file,
+          "// Generated by micro_speech/host/arena_report from g_model. Don't "
+          "edit it by\n"
+          "// hand; run `make arena_header` in micro_speech/host after "
+          "changing the model.\n"
+          "\n"
+          "#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_TENSOR_ARENA_"
+          "SIZE_H_\n"
+          "#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_TENSOR_ARENA_"
+          "SIZE_H_\n"
+          "\n"
+          "// Bytes of the arena AllocateTensors() used for g_model.\n"
+          "constexpr int kTensorArenaUsedBytes = %d;\n"
+          "// Extra bytes allowed on top of that.\n"
+          "constexpr int kTensorArenaHeadroomBytes = %d;\n"
+          "// The two added together, rounded up to a multiple of %d.\n"
+          "constexpr int kTensorArenaSize = %d;\n"
+          "\n"
+          "#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_TENSOR_ARENA_"
+          "SIZE_H_\n",
+          used_bytes, headroom_bytes, kArenaAlignment, size);
+  fclose(file);
+  printf("\nwrote %s: %d bytes used + %d headroom -> kTensorArenaSize %d\n",
+         path, used_bytes, headroom_bytes, size);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const char* header_path = nullptr;
+  int headroom_bytes = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], "--header_out=", 13) == 0) {
+      header_path = argv[i] + 13;
+    } else if (strncmp(argv[i], "--headroom_bytes=", 17) == 0) {
+      headroom_bytes = std::max(0, atoi(argv[i] + 17));
+    } else {
+      fprintf(stderr, "Usage: %s [--headroom_bytes=N] [--header_out=FILE]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  const tflite::Model* model = tflite::GetModel(g_model);
+  if (model->version() != TFLITE_SCHEMA_VERSION) {
+    fprintf(stderr, "Model schema version %d isn't the supported %d\n",
+            static_cast<int>(model->version()), TFLITE_SCHEMA_VERSION);
+    return 1;
+  }
+  // The same ops as the sketch registers.
+  static tflite::MicroMutableOpResolver<4> micro_op_resolver;
+  micro_op_resolver.AddConv2D();
+  micro_op_resolver.AddFullyConnected();
+  micro_op_resolver.AddSoftmax();
+  micro_op_resolver.AddReshape();
+
+  static tflite::RecordingMicroInterpreter interpreter(
+      model, micro_op_resolver, g_probe_arena, kProbeArenaSize);
+  if (interpreter.AllocateTensors() != kTfLiteOk) {
+    fprintf(stderr, "AllocateTensors() failed\n");
+    return 1;
+  }
+
+  const int used_bytes = static_cast<int>(interpreter.arena_used_bytes());
+  const tflite::RecordingSingleArenaBufferAllocator* allocator =
+      interpreter.GetMicroAllocator().GetSimpleMemoryAllocator();
+  printf("arena used:        %d bytes\n", used_bytes);
+  printf("  persistent:      %d bytes\n",
+         static_cast<int>(allocator->GetPersistentUsedBytes()));
+  printf("  non-persistent:  %d bytes\n",
+         static_cast<int>(allocator->GetNonPersistentUsedBytes()));
+  printf("\nrecorded allocations\n");
+  interpreter.GetMicroAllocator().PrintAllocations();
+
+  const int peak_activation_bytes = PrintTensorLifetimes(model);
+  printf("\npeak live activations: %d bytes\n", peak_activation_bytes);
+
+  if ((header_path != nullptr) &&
+      !WriteHeader(header_path, used_bytes, headroom_bytes)) {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,247 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Tests AudioRing as the firmware uses it, with a producer thread standing in
+// for the capture interrupt and the test's own thread as the main loop. The
+// producer writes a ramp, so every sample says where in the stream it belongs,
+// and the consumer checks what it reads against it. Doesn't need TFLM:
+//
+//   make test
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "audio_ring.h"
+#include "host_test.h"
+
+namespace {
+
+constexpr int kBlockSize = 64;
+constexpr int kRingSize = 1024;
+constexpr int kMirrorSize = 2 * kBlockSize;
+// As in the firmware, the two blocks the DMA owns can't be read.
+constexpr int kInFlight = 2 * kBlockSize;
+
+using Ring = AudioRing<int16_t, kRingSize, kMirrorSize>;
+
+int16_t RampSample(uint64_t position) {
+  return static_cast<int16_t>(position % 30011);
+}
+
+// Writes `block_count` blocks of the ramp into `ring`. If `consumed` is set,
+// waits before each block until the consumer has consumed enough that the
+// block won't overrun it. Otherwise, if `pace_every` is set, it pauses after
+// that many blocks each time, like a capture delivering blocks at a fixed
+// rate.
+void ProduceRamp(Ring* ring, int block_count,
+                 const std::atomic<uint64_t>* consumed, int pace_every) {
+  int16_t block[kBlockSize];
+  uint64_t position = 0;
+  for (int b = 0; b < block_count; ++b) {
+    if (consumed != nullptr) {
+      while (position + kBlockSize - consumed->load(std::memory_order_acquire) >
+             ring->history()) {
+        std::this_thread::yield();
+      }
+    }
+    for (int i = 0; i < kBlockSize; ++i) {
+      block[i] = RampSample(position + i);
+    }
+    ring->Write(block, kBlockSize);
+    position += kBlockSize;
+    if ((pace_every > 0) && (((b + 1) % pace_every) == 0)) {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+}
+
+// What the consumer saw while it read the stream a block at a time.
+struct ConsumerResult {
+  int blocks_read = 0;
+  // Reads Peek() said were stale, and blocks overwritten while being read.
+  int stale_reads = 0;
+  int torn_blocks = 0;
+  // Samples in intact blocks that weren't the ramp. Any at all is a bug.
+  int bad_samples = 0;
+  // The most samples it ever saw waiting.
+  uint64_t max_waiting = 0;
+};
+
+// Reads `block_count` blocks from `ring` like FeatureProvider does: a view from
+// Peek(), checked, then IsIntact() to catch the producer writing over it
+// meanwhile, then Consume(). Reads that fall behind skip ahead to the oldest
+// intact block. Every `stall_every` blocks it stops for 2ms, if set.
+ConsumerResult ConsumeRamp(Ring* ring, int block_count, int stall_every,
+                           std::atomic<uint64_t>* consumed) {
+  ConsumerResult result;
+  uint64_t position = 0;
+  const uint64_t end = static_cast<uint64_t>(block_count) * kBlockSize;
+  while (position < end) {
+    const uint64_t write = ring->write_position();
+    if (write < position + kBlockSize) {
+      std::this_thread::yield();
+      continue;
+    }
+    result.max_waiting = std::max(result.max_waiting, write - position);
+    const int16_t* samples;
+    if (!ring->Peek(position, &samples)) {
+      result.stale_reads += 1;
+      const uint64_t oldest = ring->write_position() - ring->history();
+      position = ((oldest + kBlockSize - 1) / kBlockSize) * kBlockSize;
+      continue;
+    }
+    int bad = 0;
+    for (int i = 0; i < kBlockSize; ++i) {
+      bad += (samples[i] != RampSample(position + i)) ? 1 : 0;
+    }
+    if (!ring->IsIntact(position)) {
+      result.torn_blocks += 1;
+    } else {
+      result.bad_samples += bad;
+    }
+    position += kBlockSize;
+    ring->Consume(position);
+    if (consumed != nullptr) {
+      consumed->store(position, std::memory_order_release);
+    }
+    result.blocks_read += 1;
+    if ((stall_every > 0) && ((result.blocks_read % stall_every) == 0)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+  }
+  return result;
+}
+
+// With the producer held back whenever it would overrun, every block arrives
+// intact and nothing is counted, while the fill level still reaches most of
+// the ring when the consumer stalls.
+void TestFlowControlledStream() {
+  std::unique_ptr<Ring> ring(new Ring(kInFlight));
+  constexpr int kBlocks = 20000;
+  std::atomic<uint64_t> consumed{0};
+  std::thread producer(ProduceRamp, ring.get(), kBlocks, &consumed, 0);
+  const ConsumerResult result =
+      ConsumeRamp(ring.get(), kBlocks, /*stall_every=*/500, &consumed);
+  producer.join();
+  HOST_EXPECT_EQ(kBlocks, result.blocks_read);
+  HOST_EXPECT_EQ(0, result.bad_samples);
+  HOST_EXPECT_EQ(0, result.stale_reads);
+  HOST_EXPECT_EQ(0, result.torn_blocks);
+  HOST_EXPECT_EQ(0, ring->overruns());
+  HOST_EXPECT_EQ(0, ring->stale_reads());
+  HOST_EXPECT(ring->high_water() <= ring->history());
+  HOST_EXPECT(ring->high_water() >= result.max_waiting);
+}
+
+// A consumer that stops altogether gets exactly one overrun for each block
+// written past the history, and a stale read for audio written over, while
+// what's left in the history reads back intact.
+void TestStalledConsumer() {
+  std::unique_ptr<Ring> ring(new Ring(kInFlight));
+  const int history_blocks = static_cast<int>(ring->history()) / kBlockSize;
+  constexpr int kBlocks = 3 * kRingSize / kBlockSize;
+  std::thread producer(ProduceRamp, ring.get(), kBlocks, nullptr, 0);
+  producer.join();
+  HOST_EXPECT_EQ(kBlocks - history_blocks, ring->overruns());
+  HOST_EXPECT_EQ(kBlocks * kBlockSize, ring->high_water());
+
+  const int16_t* samples;
+  HOST_EXPECT(!ring->Peek(0, &samples));
+  HOST_EXPECT_EQ(1, ring->stale_reads());
+  const uint64_t oldest = ring->write_position() - ring->history();
+  HOST_EXPECT(ring->Peek(oldest, &samples));
+  for (int i = 0; i < kMirrorSize; ++i) {
+    if (!HOST_EXPECT_EQ(RampSample(oldest + i), samples[i])) {
+      break;
+    }
+  }
+  HOST_EXPECT_EQ(1, ring->stale_reads());
+}
+
+// Free running, with a consumer that usually keeps up but now and then stalls
+// for longer than the ring lasts: whatever it reads intact is right, the ring
+// counts exactly the stale reads the consumer saw, every stale read comes with
+// an overrun, and the high water covers the most the consumer ever saw
+// waiting.
+void TestFreeRunningStream() {
+  std::unique_ptr<Ring> ring(new Ring(kInFlight));
+  constexpr int kBlocks = 20000;
+  std::thread producer(ProduceRamp, ring.get(), kBlocks, nullptr,
+                       /*pace_every=*/4);
+  const ConsumerResult result =
+      ConsumeRamp(ring.get(), kBlocks, /*stall_every=*/2000, nullptr);
+  producer.join();
+  HOST_EXPECT_EQ(0, result.bad_samples);
+  HOST_EXPECT_EQ(result.stale_reads, ring->stale_reads());
+  HOST_EXPECT((result.stale_reads + result.torn_blocks == 0) ||
+              (ring->overruns() > 0));
+  HOST_EXPECT(ring->overruns() <= static_cast<uint32_t>(kBlocks));
+  HOST_EXPECT(ring->high_water() >= result.max_waiting);
+}
+
+// The write position is 64 bits, published through a sequence number because
+// the Cortex-M4 can't store it in one go. The producer commits steps of nearly
+// 2^31 samples so the high word changes every other commit, and for 500ms the
+// consumer checks that every position it loads is one that was stored: a
+// multiple of the step, never going backwards. A read that mixed the words of
+// two stores would be neither.
+void TestWritePositionNeverTorn() {
+  using BigRing = AudioRing<int16_t, 1 << 20>;
+  std::unique_ptr<BigRing> ring(new BigRing());
+  constexpr int kStep = 0x7fffffff;
+  std::atomic<bool> stop{false};
+  int64_t commits = 0;
+  std::thread producer([&ring, &stop, &commits]() {
+    while (!stop.load(std::memory_order_relaxed)) {
+      ring->Commit(kStep);
+      commits += 1;
+    }
+  });
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+  uint64_t previous = 0;
+  int64_t loads = 0;
+  int torn = 0;
+  while (std::chrono::steady_clock::now() < deadline) {
+    for (int i = 0; i < 1000; ++i) {
+      const uint64_t position = ring->write_position();
+      if (((position % kStep) != 0) || (position < previous)) {
+        torn += 1;
+      }
+      previous = position;
+    }
+    loads += 1000;
+  }
+  stop.store(true, std::memory_order_relaxed);
+  producer.join();
+  HOST_EXPECT_EQ(0, torn);
+  HOST_EXPECT(previous > 0);
+  HOST_EXPECT_EQ(static_cast<uint64_t>(kStep) * commits,
+                 ring->write_position());
+}
+
+}  // namespace
+
+int main() {
+  RunHostTest("FlowControlledStream", TestFlowControlledStream);
+  RunHostTest("StalledConsumer", TestStalledConsumer);
+  RunHostTest("FreeRunningStream", TestFreeRunningStream);
+  RunHostTest("WritePositionNeverTorn", TestWritePositionNeverTorn);
+  return HostTestResult();
+}
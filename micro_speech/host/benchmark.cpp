@@ -0,0 +1,772 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Microbenchmarks for each hot stage of the keyword-spotting loop. Every case
+// reports nanoseconds and heap allocations per operation plus a throughput.
+// Results can be saved as a baseline file and compared against later:
+//
+//   ./build/micro_speech_benchmark --save=baseline.tsv
+//   ... make a change and rebuild ...
+//   ./build/micro_speech_benchmark --baseline=baseline.tsv
+
+#include <time.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "alloc_counter.h"
+#include "audio_conditioner.h"
+#include "feature_provider.h"
+#include "feature_quantizer.h"
+#include "host_audio_sources.h"
+#include "micro_features_micro_features_generator.h"
+#include "micro_features_micro_model_settings.h"
+#include "micro_features_reference.h"
+#include "micro_features_model.h"
+#include "pipeline_snapshot.h"
+#include "recognize_commands.h"
+#include "streaming_conv.h"
+#include "tensor_arena_size.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "wav_reader.h"
+
+namespace {
+
+alignas(16) uint8_t g_tensor_arena[kTensorArenaSize];
+alignas(16) uint8_t g_streaming_tensor_arena[kTensorArenaSize];
+alignas(8) uint8_t g_streaming_conv_workspace
+    [TinyConvStreamingWorkspaceSize<DefaultModelSettings>()];
+
+struct BenchmarkResult {
+  std::string name;
+  double ns_per_op;
+  double allocs_per_op;
+  double throughput;
+  std::string unit;
+};
+
+double NowSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Runs `op` in batches of growing size until one batch takes at least
+// `min_seconds`, and reports the per-operation cost of that batch.
+// `units_per_op` is how many `unit`s of work one call to `op` does.
+template <typename Op>
+BenchmarkResult RunBenchmark(const std::string& name, double min_seconds,
+                             double units_per_op, const char* unit, Op op) {
+  op();  // Warm up caches and any lazy initialization.
+  int64_t iterations = 1;
+  while (true) {
+    const uint64_t allocs_before = AllocationCount();
+    const double start = NowSeconds();
+    for (int64_t i = 0; i < iterations; ++i) {
+      op();
+    }
+    const double elapsed = NowSeconds() - start;
+    const uint64_t allocs = AllocationCount() - allocs_before;
+    if ((elapsed >= min_seconds) || (iterations >= (int64_t{1} << 32))) {
+      BenchmarkResult result;
+      result.name = name;
+      result.ns_per_op = (elapsed * 1e9) / iterations;
+      result.allocs_per_op = static_cast<double>(allocs) / iterations;
+      result.throughput = (units_per_op * iterations) / elapsed;
+      result.unit = unit;
+      return result;
+    }
+    // Aim a little past the target so the next batch is usually the last.
+    const double scale =
+        (elapsed > 0) ? std::min(100.0, (min_seconds * 1.2) / elapsed) : 100.0;
+    iterations = std::max(iterations * 2,
+                          static_cast<int64_t>(iterations * scale));
+  }
+}
+
+bool ReadBaseline(const char* path,
+                  std::map<std::string, BenchmarkResult>* baseline) {
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) {
+    fprintf(stderr, "Couldn't open baseline %s\n", path);
+    return false;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    if (line[0] == '#') {
+      continue;
+    }
+    char name[128];
+    char unit[32];
+    BenchmarkResult result;
+    if (sscanf(line, "%127s %lf %lf %lf %31s", name, &result.ns_per_op,
+               &result.allocs_per_op, &result.throughput, unit) == 5) {
+      result.name = name;
+      result.unit = unit;
+      (*baseline)[result.name] = result;
+    }
+  }
+  fclose(file);
+  return true;
+}
+
+bool WriteBaseline(const char* path,
+                   const std::vector<BenchmarkResult>& results) {
+  FILE* file = fopen(path, "w");
+  if (file == nullptr) {
+    fprintf(stderr, "Couldn't write baseline %s\n", path);
+    return false;
+  }
+  fprintf(file, "# name\tns_per_op\tallocs_per_op\tthroughput\tunit\n");
+  for (const BenchmarkResult& result : results) {
+    fprintf(file, "%s\t%.1f\t%.3f\t%.1f\t%s\n", result.name.c_str(),
+            result.ns_per_op, result.allocs_per_op, result.throughput,
+            result.unit.c_str());
+  }
+  fclose(file);
+  return true;
+}
+
+void PrintResult(const BenchmarkResult& result,
+                 const std::map<std::string, BenchmarkResult>& baseline) {
+  printf("%-32s %12.1f %10.3f %14.1f %-10s", result.name.c_str(),
+         result.ns_per_op, result.allocs_per_op, result.throughput,
+         result.unit.c_str());
+  auto previous = baseline.find(result.name);
+  if (previous != baseline.end()) {
+    const double change =
+        ((result.ns_per_op - previous->second.ns_per_op) * 100.0) /
+        previous->second.ns_per_op;
+    printf(" %+7.1f%%", change);
+  }
+  printf("\n");
+}
+
+// What loop() did to the spectrogram before it was kept as a ring, for the
+// FeatureWindow/ cases: shift the slices that stay in the window to the front a
+// byte at a time, making room for `new_slices` at the end, then copy the
+// whole window to the model input the same way.
+void ShiftAndCopyFeaturesReference(int8_t* feature_data, int new_slices,
+                                   int8_t* model_input) {
+  const int slices_to_keep = kFeatureSliceCount - new_slices;
+  for (int dest_slice = 0; dest_slice < slices_to_keep; ++dest_slice) {
+    int8_t* dest_slice_data = feature_data + (dest_slice * kFeatureSliceSize);
+    const int8_t* src_slice_data =
+        feature_data + ((dest_slice + new_slices) * kFeatureSliceSize);
+    for (int i = 0; i < kFeatureSliceSize; ++i) {
+      dest_slice_data[i] = src_slice_data[i];
+    }
+  }
+  for (int i = 0; i < kFeatureElementCount; i++) {
+    model_input[i] = feature_data[i];
+  }
+}
+
+// The features of `samples` played `repeats` times over, slice after slice.
+std::vector<int8_t> StreamFeatureSlices(const std::vector<int16_t>& samples,
+                                        int repeats) {
+  std::vector<int8_t> slices;
+  MicroFeaturesContext context;
+  if (InitializeMicroFeatures(&context) != kTfLiteOk) {
+    return slices;
+  }
+  int8_t slice[kFeatureSliceSize];
+  for (int i = 0; i < repeats; ++i) {
+    for (size_t offset = 0; offset < samples.size();) {
+      size_t num_samples_read;
+      bool has_slice = false;
+      StreamMicroFeatures(&context, samples.data() + offset,
+                          samples.size() - offset, slice, &num_samples_read,
+                          &has_slice);
+      offset += num_samples_read;
+      if (has_slice) {
+        slices.insert(slices.end(), slice, slice + kFeatureSliceSize);
+      }
+    }
+  }
+  FreeMicroFeatures(&context);
+  return slices;
+}
+
+// Times one pass of a source's whole clip through the sketch's feature path:
+// each op rewinds `source` and streams it through a FeatureProvider, stepping
+// time the way loop() does. The pipeline code is the same for every source, so
+// differences between the "Pipeline/" cases are the cost of the sources.
+// `Settings` is the pipeline configuration, which `source` must capture at the
+// sample rate of.
+template <typename Source, typename Settings = DefaultModelSettings>
+bool BenchmarkPipeline(const std::string& name, Source* source,
+                       double min_seconds, BenchmarkResult* result) {
+  static int8_t feature_buffer[Settings::kFeatureElementCount];
+  MicroFeaturesContext context;
+  FeatureProvider<Source, Settings> feature_provider(
+      source, Settings::kFeatureElementCount, feature_buffer, &context,
+      kFeatureFeedStream);
+  int how_many_new_slices = 0;
+  // The first call only initializes the frontend.
+  feature_provider.PopulateFeatureData(0, 0, &how_many_new_slices);
+  bool ok = true;
+  int64_t samples = 0;
+  auto stream = [&]() {
+    source->Restart();
+    source->Init();
+    int64_t previous_time = 0;
+    while (ok && !source->Finished()) {
+      const int64_t current_time = source->LatestSampleCount();
+      how_many_new_slices = 0;
+      ok = (feature_provider.PopulateFeatureData(previous_time, current_time,
+                                                 &how_many_new_slices) ==
+            kTfLiteOk);
+      previous_time +=
+          how_many_new_slices * Settings::kFeatureSliceStrideSamples;
+    }
+    samples = source->LatestSampleCount();
+  };
+  stream();
+  if (!ok || (samples == 0)) {
+    fprintf(stderr, "%s: no audio streamed\n", name.c_str());
+    FreeMicroFeatures(&context);
+    return false;
+  }
+  *result = RunBenchmark(name, min_seconds, samples, "samples/s", stream);
+  FreeMicroFeatures(&context);
+  return ok;
+}
+
+// Times the feature pipeline built for `Settings` (see ModelSettings) on
+// `samples`, a clip at DefaultModelSettings' sample rate, brought down to
+// the configuration's by averaging: one slice through the frontend, then the
+// whole clip through a FeatureProvider. The model and recognizer cost the same
+// per inference in every configuration with the same categories.
+template <typename Settings>
+bool BenchmarkSettings(const std::vector<int16_t>& samples, double min_seconds,
+                       std::vector<BenchmarkResult>* results) {
+  constexpr int kDecimation =
+      DefaultModelSettings::kAudioSampleFrequency /
+      Settings::kAudioSampleFrequency;
+  static_assert(
+      kDecimation * Settings::kAudioSampleFrequency ==
+          DefaultModelSettings::kAudioSampleFrequency,
+      "The clip can only be brought down by a whole factor");
+  std::vector<int16_t> settings_samples(samples.size() / kDecimation);
+  for (size_t i = 0; i < settings_samples.size(); ++i) {
+    int32_t sum = 0;
+    for (int j = 0; j < kDecimation; ++j) {
+      sum += samples[(i * kDecimation) + j];
+    }
+    settings_samples[i] = static_cast<int16_t>(sum / kDecimation);
+  }
+  if (static_cast<int>(settings_samples.size()) <
+      Settings::kFeatureSliceDurationSamples) {
+    fprintf(stderr, "The clip is too short for a %s slice\n",
+            Settings::kName);
+    return false;
+  }
+  const std::string prefix = std::string("Settings/") + Settings::kName;
+
+  MicroFeaturesContext context;
+  if (InitializeMicroFeatures<Settings>(&context) != kTfLiteOk) {
+    return false;
+  }
+  int8_t features[Settings::kFeatureSliceSize];
+  results->push_back(RunBenchmark(
+      prefix + "/slice", min_seconds, 1.0, "slices/s", [&]() {
+        size_t num_samples_read;
+        GenerateMicroFeatures<Settings>(
+            &context, settings_samples.data(),
+            Settings::kFeatureSliceDurationSamples,
+            Settings::kFeatureSliceSize, features, &num_samples_read);
+      }));
+  FreeMicroFeatures(&context);
+
+  WavAudioSource source;
+  source.LoadSamples(settings_samples.data(),
+                     static_cast<int>(settings_samples.size()));
+  BenchmarkResult result;
+  if (!BenchmarkPipeline<WavAudioSource, Settings>(prefix + "/pipeline",
+                                                   &source, min_seconds,
+                                                   &result)) {
+    return false;
+  }
+  results->push_back(result);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const char* wav_path = "../data/yes_1000ms.wav";
+  const char* baseline_path = nullptr;
+  const char* save_path = nullptr;
+  const char* filter = "";
+  double min_seconds = 0.5;
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], "--baseline=", 11) == 0) {
+      baseline_path = argv[i] + 11;
+    } else if (strncmp(argv[i], "--save=", 7) == 0) {
+      save_path = argv[i] + 7;
+    } else if (strncmp(argv[i], "--filter=", 9) == 0) {
+      filter = argv[i] + 9;
+    } else if (strncmp(argv[i], "--min_time=", 11) == 0) {
+      min_seconds = atof(argv[i] + 11);
+    } else if (argv[i][0] != '-') {
+      wav_path = argv[i];
+    } else {
+      fprintf(stderr,
+              "Usage: %s [--baseline=FILE] [--save=FILE] [--filter=SUBSTRING] "
+              "[--min_time=SECONDS] [file.wav]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  std::map<std::string, BenchmarkResult> baseline;
+  if ((baseline_path != nullptr) && !ReadBaseline(baseline_path, &baseline)) {
+    return 1;
+  }
+
+  // Fill the capture ring with real speech so every stage sees realistic data.
+  WavAudioSource audio_source;
+  if (!audio_source.LoadWav(wav_path)) {
+    return 1;
+  }
+  audio_source.Init();
+  while (!audio_source.Finished()) {
+    audio_source.LatestSampleCount();
+  }
+
+  // The same model setup as the sketch.
+  const tflite::Model* model = tflite::GetModel(g_model);
+  static tflite::MicroMutableOpResolver<4> micro_op_resolver;
+  micro_op_resolver.AddConv2D();
+  micro_op_resolver.AddFullyConnected();
+  micro_op_resolver.AddSoftmax();
+  micro_op_resolver.AddReshape();
+  static tflite::MicroInterpreter interpreter(model, micro_op_resolver,
+                                              g_tensor_arena, kTensorArenaSize);
+  if (interpreter.AllocateTensors() != kTfLiteOk) {
+    fprintf(stderr, "AllocateTensors() failed\n");
+    return 1;
+  }
+  TfLiteTensor* model_input = interpreter.input(0);
+  TfLiteTensor* model_output = interpreter.output(0);
+
+  std::vector<BenchmarkResult> results;
+  auto selected = [filter](const std::string& name) {
+    return name.find(filter) != std::string::npos;
+  };
+  auto report = [&results, &baseline](const BenchmarkResult& result) {
+    PrintResult(result, baseline);
+    results.push_back(result);
+  };
+
+  printf("%-32s %12s %10s %14s %-10s %s\n", "benchmark", "ns/op", "allocs/op",
+         "throughput", "unit", baseline.empty() ? "" : "   vs base");
+
+  constexpr int kSliceSampleCount = kFeatureSliceDurationSamples;
+
+  if (selected("ConditionAudioBlock")) {
+    // One DMA block of raw codes, conditioned in place over and over; the
+    // filter's cost doesn't depend on the values.
+    alignas(4) static int16_t block[kHostCaptureBlockSize];
+    for (int i = 0; i < kHostCaptureBlockSize; ++i) {
+      block[i] =
+          static_cast<int16_t>(kAudioConditionerMidScale + (i * 13) % 512);
+    }
+    AudioConditioner conditioner;
+    InitAudioConditioner(&conditioner);
+    report(RunBenchmark("ConditionAudioBlock/block", min_seconds,
+                        kHostCaptureBlockSize, "samples/s", [&]() {
+                          ConditionAudioBlock(&conditioner, block,
+                                              kHostCaptureBlockSize);
+                        }));
+    report(RunBenchmark("ConditionAudioBlockReference/block", min_seconds,
+                        kHostCaptureBlockSize, "samples/s", [&]() {
+                          ConditionAudioBlockReference(&conditioner, block,
+                                                       kHostCaptureBlockSize);
+                        }));
+  }
+
+  if (selected("QuantizeFeatures")) {
+    // One slice's worth of logs across the frontend's usual 0 to 670 range.
+    alignas(16) static uint16_t logs[kFeatureSliceSize];
+    for (int i = 0; i < kFeatureSliceSize; ++i) {
+      logs[i] = static_cast<uint16_t>((i * 97) % 700);
+    }
+    int8_t features[kFeatureSliceSize];
+    report(RunBenchmark("QuantizeFeatures/slice", min_seconds,
+                        kFeatureSliceSize, "values/s", [&]() {
+                          QuantizeFeatures(logs, kFeatureSliceSize, features);
+                        }));
+    report(RunBenchmark("QuantizeFeatureReference/slice", min_seconds,
+                        kFeatureSliceSize, "values/s", [&]() {
+                          for (int i = 0; i < kFeatureSliceSize; ++i) {
+                            features[i] = QuantizeFeatureReference(logs[i]);
+                          }
+                        }));
+  }
+
+  if (selected("GenerateMicroFeatures")) {
+    const int16_t* audio_samples = nullptr;
+    int audio_samples_size = 0;
+    audio_source.GetSamples(200 * kAudioSamplesPerMs, kSliceSampleCount,
+                            &audio_samples_size, &audio_samples);
+    std::vector<int16_t> slice(audio_samples, audio_samples + audio_samples_size);
+    InitializeMicroFeatures();
+    int8_t features[kFeatureSliceSize];
+    report(RunBenchmark("GenerateMicroFeatures/slice", min_seconds, 1.0,
+                        "slices/s", [&]() {
+                          size_t num_samples_read;
+                          GenerateMicroFeatures(slice.data(), kSliceSampleCount,
+                                                kFeatureSliceSize, features,
+                                                &num_samples_read);
+                        }));
+    MicroFeaturesContext reference_context;
+    InitializeMicroFeatures(&reference_context);
+    report(RunBenchmark("GenerateMicroFeaturesReference/slice", min_seconds,
+                        1.0, "slices/s", [&]() {
+                          size_t num_samples_read;
+                          GenerateMicroFeaturesReference(
+                              &reference_context, slice.data(),
+                              kSliceSampleCount, kFeatureSliceSize, features,
+                              &num_samples_read);
+                        }));
+    FreeMicroFeatures(&reference_context);
+  }
+
+  if (selected("CatchUp")) {
+    std::vector<int16_t> wav_samples;
+    int sample_rate;
+    if (!ReadWavFile(wav_path, &wav_samples, &sample_rate)) {
+      return 1;
+    }
+    // The latency of catching up on a run of slices from a fresh window: the
+    // batch against pushing them in one slice at a time.
+    const int max_slices = std::min<int>(
+        kFeatureSliceCount,
+        (static_cast<int>(wav_samples.size()) - kFeatureSliceDurationSamples) /
+                kFeatureSliceStrideSamples +
+            1);
+    MicroFeaturesContext context;
+    InitializeMicroFeatures(&context);
+    static int8_t ring[kFeatureElementCount];
+    for (int slice_count : {1, 2, 4, 8, 16, 32, kFeatureSliceCount}) {
+      slice_count = std::min(slice_count, max_slices);
+      const int sample_count =
+          kFeatureSliceDurationSamples +
+          (slice_count - 1) * kFeatureSliceStrideSamples;
+      const std::string suffix = "/" + std::to_string(slice_count);
+      report(RunBenchmark("CatchUp/per_slice" + suffix, min_seconds,
+                          slice_count, "slices/s", [&]() {
+                            ResetMicroFeaturesWindow(&context);
+                            int slot = 0;
+                            for (int offset = 0; offset < sample_count;) {
+                              size_t num_samples_read;
+                              bool has_slice;
+                              StreamMicroFeatures(
+                                  &context, wav_samples.data() + offset,
+                                  sample_count - offset,
+                                  ring + (slot * kFeatureSliceSize),
+                                  &num_samples_read, &has_slice);
+                              offset += static_cast<int>(num_samples_read);
+                              slot += has_slice ? 1 : 0;
+                            }
+                          }));
+      report(RunBenchmark("CatchUp/batched" + suffix, min_seconds,
+                          slice_count, "slices/s", [&]() {
+                            ResetMicroFeaturesWindow(&context);
+                            int slot = 0;
+                            int slices_made;
+                            StreamMicroFeatureSlices(
+                                &context, wav_samples.data(), sample_count,
+                                ring, kFeatureSliceCount, &slot, &slices_made);
+                          }));
+    }
+    FreeMicroFeatures(&context);
+  }
+
+  for (const FeatureFeed feed : {kFeatureFeedWindows, kFeatureFeedStream}) {
+    for (int slice_count : {1, 2, kFeatureSliceCount}) {
+      const std::string name =
+          std::string("PopulateFeatureData/") +
+          ((feed == kFeatureFeedStream) ? "stream/" : "") +
+          std::to_string(slice_count);
+      if (!selected(name)) {
+        continue;
+      }
+      static int8_t feature_buffer[kFeatureElementCount];
+      FeatureProvider<WavAudioSource> feature_provider(
+          &audio_source, kFeatureElementCount, feature_buffer, nullptr, feed);
+      int how_many_new_slices = 0;
+      // The first call only initializes the frontend.
+      feature_provider.PopulateFeatureData(0, 0, &how_many_new_slices);
+      // Advancing the clock by this much yields exactly `slice_count` slices.
+      const int64_t step = slice_count * kFeatureSliceStrideSamples;
+      const int64_t lookahead =
+          kFeatureSliceDurationSamples - kFeatureSliceStrideSamples;
+      int64_t previous_time = 0;
+      feature_provider.PopulateFeatureData(previous_time,
+                                           previous_time + step + lookahead,
+                                           &how_many_new_slices);
+      if (how_many_new_slices != slice_count) {
+        fprintf(stderr, "%s: expected %d new slices, got %d\n", name.c_str(),
+                slice_count, how_many_new_slices);
+        return 1;
+      }
+      report(RunBenchmark(name, min_seconds, slice_count, "slices/s", [&]() {
+        previous_time += step;
+        feature_provider.PopulateFeatureData(
+            previous_time, previous_time + step + lookahead,
+            &how_many_new_slices);
+      }));
+    }
+  }
+
+  // The window bookkeeping of one pass through loop() with a single new
+  // slice, leaving out the slice's features, which cost the same either way.
+  if (selected("FeatureWindow")) {
+    static int8_t feature_data[kFeatureElementCount];
+    for (int i = 0; i < kFeatureElementCount; ++i) {
+      feature_data[i] = static_cast<int8_t>((i * 37) % 256 - 128);
+    }
+    report(RunBenchmark("FeatureWindow/shift_and_copy", min_seconds, 1.0,
+                        "loops/s", [&]() {
+                          ShiftAndCopyFeaturesReference(
+                              feature_data, 1, model_input->data.int8);
+                        }));
+    int oldest_slice = 0;
+    report(RunBenchmark(
+        "FeatureWindow/ring", min_seconds, 1.0, "loops/s", [&]() {
+          oldest_slice = (oldest_slice + 1) % kFeatureSliceCount;
+          CopyFeatureSlices(feature_data, oldest_slice,
+                            model_input->data.int8);
+        }));
+  }
+
+  if (selected("MicroInterpreter::Invoke")) {
+    for (int i = 0; i < kFeatureElementCount; ++i) {
+      model_input->data.int8[i] = static_cast<int8_t>((i * 37) % 256 - 128);
+    }
+    report(RunBenchmark("MicroInterpreter::Invoke", min_seconds, 1.0,
+                        "invokes/s", [&]() { interpreter.Invoke(); }));
+  }
+
+  // Inference on a window that slides one slice between invokes, as it does
+  // in loop(), with the stock and the streaming convolution.
+  if (selected("StreamingConv")) {
+    std::vector<int16_t> wav_samples;
+    int sample_rate;
+    if (!ReadWavFile(wav_path, &wav_samples, &sample_rate)) {
+      return 1;
+    }
+    const std::vector<int8_t> slices = StreamFeatureSlices(wav_samples, 8);
+    const int slice_count = static_cast<int>(slices.size()) / kFeatureSliceSize;
+    if (slice_count <= kFeatureSliceCount) {
+      fprintf(stderr, "The clip is too short to slide a window over\n");
+      return 1;
+    }
+    SetStreamingConvWorkspace(g_streaming_conv_workspace,
+                              sizeof(g_streaming_conv_workspace));
+    static tflite::MicroMutableOpResolver<4> streaming_op_resolver;
+    streaming_op_resolver.AddConv2D(Register_STREAMING_CONV_2D());
+    streaming_op_resolver.AddFullyConnected();
+    streaming_op_resolver.AddSoftmax();
+    streaming_op_resolver.AddReshape();
+    static tflite::MicroInterpreter streaming_interpreter(
+        model, streaming_op_resolver, g_streaming_tensor_arena,
+        kTensorArenaSize);
+    if (streaming_interpreter.AllocateTensors() != kTfLiteOk) {
+      fprintf(stderr, "AllocateTensors() failed with streaming\n");
+      return 1;
+    }
+    auto slide = [&](tflite::MicroInterpreter* slide_interpreter, int* start) {
+      *start = (*start + 1) % (slice_count - kFeatureSliceCount);
+      memcpy(slide_interpreter->input(0)->data.int8,
+             slices.data() + (*start * kFeatureSliceSize),
+             kFeatureElementCount);
+      slide_interpreter->Invoke();
+    };
+    int start = 0;
+    report(RunBenchmark("StreamingConv/stock", min_seconds, 1.0, "invokes/s",
+                        [&]() { slide(&interpreter, &start); }));
+    StreamingConvStats before;
+    GetStreamingConvStats(&before);
+    start = 0;
+    report(RunBenchmark("StreamingConv/streaming", min_seconds, 1.0,
+                        "invokes/s",
+                        [&]() { slide(&streaming_interpreter, &start); }));
+    StreamingConvStats after;
+    GetStreamingConvStats(&after);
+    const uint32_t rows = (after.rows_computed - before.rows_computed) +
+                          (after.rows_reused - before.rows_reused);
+    printf("  %.1f%% of convolution rows computed\n",
+           (rows == 0) ? 0.0
+                       : 100.0 * (after.rows_computed - before.rows_computed) /
+                             rows);
+  }
+
+  if (selected("ProcessLatestResults")) {
+    // A window of 49 strides keeps the results queue at its 50-entry limit
+    // when a result arrives every stride.
+    constexpr int kMaxQueuedResults = 50;
+    RecognizeCommands<> recognizer(
+        (kMaxQueuedResults - 1) * kFeatureSliceStrideMs);
+    interpreter.Invoke();
+    int64_t current_time = 0;
+    const char* found_command = nullptr;
+    uint8_t score = 0;
+    bool is_new_command = false;
+    for (int i = 0; i < kMaxQueuedResults; ++i) {
+      recognizer.ProcessLatestResults(model_output, current_time,
+                                      &found_command, &score, &is_new_command);
+      current_time += kFeatureSliceStrideSamples;
+    }
+    report(RunBenchmark("ProcessLatestResults/full_queue", min_seconds, 1.0,
+                        "results/s", [&]() {
+                          recognizer.ProcessLatestResults(
+                              model_output, current_time, &found_command,
+                              &score, &is_new_command);
+                          current_time += kFeatureSliceStrideSamples;
+                        }));
+  }
+
+  // What loop() spends saving the pipeline's state every second, and setup()
+  // restoring it.
+  if (selected("Snapshot")) {
+    static int8_t feature_buffer[kFeatureElementCount];
+    MicroFeaturesContext context;
+    FeatureProvider<WavAudioSource> feature_provider(
+        &audio_source, kFeatureElementCount, feature_buffer, &context,
+        kFeatureFeedStream);
+    int how_many_new_slices = 0;
+    feature_provider.PopulateFeatureData(0, 0, &how_many_new_slices);
+    RecognizeCommands<> recognizer;
+    static PipelineSnapshot<> snapshot;
+    report(RunBenchmark("Snapshot/take", min_seconds, 1.0, "snapshots/s",
+                        [&]() {
+                          TakePipelineSnapshot(feature_provider, recognizer,
+                                               0, &snapshot);
+                        }));
+    report(RunBenchmark("Snapshot/restore", min_seconds, 1.0, "restores/s",
+                        [&]() {
+                          RestorePipelineSnapshot(snapshot, 0,
+                                                  &feature_provider,
+                                                  &recognizer);
+                        }));
+    FreeMicroFeatures(&context);
+  }
+
+  if (selected("Settings")) {
+    // The same clip through each pipeline configuration.
+    std::vector<int16_t> wav_samples;
+    int sample_rate;
+    if (!ReadWavFile(wav_path, &wav_samples, &sample_rate)) {
+      return 1;
+    }
+    std::vector<BenchmarkResult> settings_results;
+    if (!BenchmarkSettings<DefaultModelSettings>(wav_samples, min_seconds,
+                                                 &settings_results) ||
+        !BenchmarkSettings<LowPowerModelSettings>(wav_samples, min_seconds,
+                                                  &settings_results)) {
+      return 1;
+    }
+    for (const BenchmarkResult& result : settings_results) {
+      report(result);
+    }
+  }
+
+  if (selected("AudioSource::GetSamples")) {
+    // A slice starting 14ms before the most recent multiple of the ring's
+    // length straddles the wrap.
+    constexpr int64_t kRingSamples = kAudioCaptureBufferSize;
+    const int64_t wrap_start =
+        ((audio_source.LatestSampleCount() - 1) / kRingSamples) *
+            kRingSamples -
+        (14 * kAudioSamplesPerMs);
+    report(RunBenchmark("AudioSource::GetSamples/wrap", min_seconds,
+                        kSliceSampleCount, "samples/s", [&]() {
+                          const int16_t* audio_samples = nullptr;
+                          int audio_samples_size = 0;
+                          audio_source.GetSamples(wrap_start, kSliceSampleCount,
+                                                  &audio_samples_size,
+                                                  &audio_samples);
+                        }));
+  }
+
+  // The same clip, or a synthetic one of the same length, from each source.
+  BenchmarkResult pipeline_result;
+  if (selected("Pipeline/wav")) {
+    WavAudioSource source;
+    if (!source.LoadWav(wav_path) ||
+        !BenchmarkPipeline("Pipeline/wav", &source, min_seconds,
+                           &pipeline_result)) {
+      return 1;
+    }
+    report(pipeline_result);
+  }
+  if (selected("Pipeline/stream")) {
+    // Raw PCM read through stdio, as from stdin, but from a file so it can be
+    // rewound for every op.
+    FILE* stream = tmpfile();
+    if (stream == nullptr) {
+      fprintf(stderr, "Couldn't create a temporary file\n");
+      return 1;
+    }
+    WavAudioSource wav;
+    std::vector<int16_t> block(kHostCaptureBlockSize);
+    wav.LoadWav(wav_path);
+    for (int i = 0; i < wav.sample_count(); i += kHostCaptureBlockSize) {
+      wav.ReadBlock(block.data(), kHostCaptureBlockSize);
+      fwrite(block.data(), sizeof(int16_t),
+             std::min(kHostCaptureBlockSize, wav.sample_count() - i), stream);
+    }
+    RawStreamAudioSource source(stream);
+    const bool ok = BenchmarkPipeline("Pipeline/stream", &source, min_seconds,
+                                      &pipeline_result);
+    fclose(stream);
+    if (!ok) {
+      return 1;
+    }
+    report(pipeline_result);
+  }
+  if (selected("Pipeline/tone")) {
+    SyntheticAudioSource source(audio_source.sample_count(), 1000.0, 8000, 0);
+    if (!BenchmarkPipeline("Pipeline/tone", &source, min_seconds,
+                           &pipeline_result)) {
+      return 1;
+    }
+    report(pipeline_result);
+  }
+  if (selected("Pipeline/noise")) {
+    SyntheticAudioSource source(audio_source.sample_count(), 0.0, 0, 2000);
+    if (!BenchmarkPipeline("Pipeline/noise", &source, min_seconds,
+                           &pipeline_result)) {
+      return 1;
+    }
+    report(pipeline_result);
+  }
+
+  if ((save_path != nullptr) && !WriteBaseline(save_path, results)) {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,276 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Tests BlockCapture's DMA ping-pong against the simulated SAADC, with the
+// interrupt serviced as SaadcAudioSource::HandleInterrupt() services it, into
+// the AudioRing the firmware uses. The peripheral is fed a ramp, so every
+// sample says where in the stream it belongs. Doesn't need TFLM:
+//
+//   make test
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "audio_ring.h"
+#include "block_capture.h"
+#include "host_test.h"
+#include "simulated_saadc.h"
+
+namespace {
+
+constexpr int kBlockSize = 16;
+constexpr int kBlockCount = 8;
+constexpr int kRingSize = kBlockSize * kBlockCount;
+// As in the firmware: the block the SAADC is filling and the one queued after
+// it can't be read.
+constexpr int kInFlight = 2 * kBlockSize;
+
+// The sample the ramp has at `position`.
+int16_t RampSample(int64_t position) {
+  return static_cast<int16_t>(position % 30000);
+}
+
+// The firmware's capture path, with the simulated peripheral in place of the
+// SAADC and a record of what its interrupt handler saw.
+class TestCapture {
+ public:
+  TestCapture()
+      : ring_(kInFlight),
+        block_capture_(&saadc_, ring_.data(), kBlockSize, kBlockCount) {}
+
+  void Start() {
+    block_capture_.Start();
+    HandleInterrupt();
+  }
+
+  // The SAMPLE task for the next sample of the ramp. The interrupt is left
+  // pending unless `service`.
+  void Sample(bool service = true) {
+    saadc_.Sample(RampSample(samples_taken_));
+    samples_taken_ += 1;
+    if (service && saadc_.interrupt_pending()) {
+      HandleInterrupt();
+    }
+  }
+
+  // Like SaadcAudioSource::HandleInterrupt(), logging each event as 'E' or
+  // 'S', and checking that every STARTED queues the block after the one just
+  // latched.
+  void HandleInterrupt() {
+    if (saadc_.events_end) {
+      saadc_.events_end = false;
+      completed_blocks_.push_back(block_capture_.OnEnd());
+      ring_.Commit(kBlockSize);
+      events_ += 'E';
+    }
+    if (saadc_.events_started) {
+      saadc_.events_started = false;
+      block_capture_.OnStarted();
+      events_ += 'S';
+      const int latched = BlockIndex(saadc_.buffer());
+      HOST_EXPECT_EQ((latched + 1) % kBlockCount,
+                     BlockIndex(saadc_.pending_buffer()));
+    }
+  }
+
+  int BlockIndex(const int16_t* buffer) {
+    return static_cast<int>(buffer - ring_.data()) / kBlockSize;
+  }
+
+  // Whether every sample the ring says is readable holds the ramp.
+  bool HistoryIntact() {
+    const uint64_t write = ring_.write_position();
+    const uint64_t oldest =
+        (write > ring_.history()) ? write - ring_.history() : 0;
+    for (uint64_t position = oldest; position < write; ++position) {
+      if (!HOST_EXPECT_EQ(RampSample(position),
+                          ring_.data()[position % kRingSize])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  using Ring = AudioRing<int16_t, kRingSize>;
+  Ring& ring() { return ring_; }
+  int64_t samples_taken() const { return samples_taken_; }
+  const std::vector<int>& completed_blocks() const {
+    return completed_blocks_;
+  }
+  const std::string& events() const { return events_; }
+  uint32_t blocks_completed() const {
+    return block_capture_.blocks_completed();
+  }
+
+ private:
+  Ring ring_;
+  SimulatedSaadc saadc_;
+  BlockCapture<SimulatedSaadc> block_capture_;
+  int64_t samples_taken_ = 0;
+  std::vector<int> completed_blocks_;
+  std::string events_;
+};
+
+// Blocks complete in ring order, each holding the samples it was given in
+// order, and the ring reads back as one unbroken stream.
+void TestBlocksCompleteInOrder() {
+  TestCapture capture;
+  capture.Start();
+  constexpr int kBlocks = 3 * kBlockCount + 2;
+  for (int i = 0; i < kBlocks * kBlockSize; ++i) {
+    capture.Sample();
+  }
+  HOST_EXPECT_EQ(kBlocks, capture.completed_blocks().size());
+  HOST_EXPECT_EQ(kBlocks, capture.blocks_completed());
+  for (int i = 0; i < static_cast<int>(capture.completed_blocks().size());
+       ++i) {
+    if (!HOST_EXPECT_EQ(i % kBlockCount, capture.completed_blocks()[i])) {
+      break;
+    }
+  }
+  HOST_EXPECT(capture.HistoryIntact());
+}
+
+// STARTED comes first, on the START that begins capture, then each END comes
+// with the STARTED of the automatic restart, and END is handled first. Each
+// STARTED queues the block after the latched one (checked in the handler).
+void TestStartedAndEndInterleave() {
+  TestCapture capture;
+  capture.Start();
+  HOST_EXPECT(capture.events() == "S");
+  constexpr int kBlocks = 2 * kBlockCount;
+  for (int i = 0; i < kBlocks * kBlockSize; ++i) {
+    capture.Sample();
+  }
+  std::string expected = "S";
+  for (int i = 0; i < kBlocks; ++i) {
+    expected += "ES";
+  }
+  HOST_EXPECT(capture.events() == expected);
+}
+
+// The sample clock only moves when an END is handled, and then by exactly one
+// block.
+void TestTimestampsStepByBlocks() {
+  TestCapture capture;
+  capture.Start();
+  uint64_t previous = capture.ring().write_position();
+  HOST_EXPECT_EQ(0, previous);
+  for (int i = 0; i < 5 * kBlockCount * kBlockSize; ++i) {
+    const size_t ends_before = capture.completed_blocks().size();
+    capture.Sample();
+    const uint64_t now = capture.ring().write_position();
+    const bool ended = capture.completed_blocks().size() > ends_before;
+    if (!HOST_EXPECT_EQ(ended ? previous + kBlockSize : previous, now)) {
+      break;
+    }
+    previous = now;
+  }
+  HOST_EXPECT_EQ(
+      (capture.samples_taken() / kBlockSize) * kBlockSize,
+      capture.ring().write_position());
+}
+
+// The interrupt may be serviced late, as long as it's within a block of the
+// events: the peripheral has already latched the next block, so nothing is
+// lost.
+void TestLateInterruptLosesNothing() {
+  for (int delay = 1; delay < kBlockSize; ++delay) {
+    TestCapture capture;
+    capture.Start();
+    int pending_for = -1;
+    for (int i = 0; i < 3 * kBlockCount * kBlockSize; ++i) {
+      capture.Sample(/*service=*/false);
+      if ((pending_for < 0) && (capture.samples_taken() % kBlockSize == 0)) {
+        pending_for = 0;
+      }
+      if ((pending_for >= 0) && (pending_for++ == delay)) {
+        capture.HandleInterrupt();
+        pending_for = -1;
+      }
+    }
+    if (!HOST_EXPECT(capture.HistoryIntact()) ||
+        !HOST_EXPECT_EQ(3 * kBlockCount - 1,
+                        capture.completed_blocks().size())) {
+      break;
+    }
+  }
+}
+
+// A consumer that keeps up sees no overruns or stale reads, and the ring never
+// holds more than the block just delivered.
+void TestConsumerKeepingUp() {
+  TestCapture capture;
+  capture.Start();
+  for (int i = 0; i < 4 * kBlockCount * kBlockSize; ++i) {
+    capture.Sample();
+    const uint64_t write = capture.ring().write_position();
+    const int16_t* samples;
+    if (write >= kBlockSize) {
+      HOST_EXPECT(capture.ring().Peek(write - kBlockSize, &samples));
+    }
+    capture.ring().Consume(write);
+  }
+  HOST_EXPECT_EQ(0, capture.ring().overruns());
+  HOST_EXPECT_EQ(0, capture.ring().stale_reads());
+  HOST_EXPECT_EQ(kBlockSize, capture.ring().high_water());
+}
+
+// A consumer that stops reading gets an overrun for every block past the
+// history, and a stale read when it asks for audio that has been written over.
+// What's still in the history is intact, and once it catches up the overruns
+// stop.
+void TestConsumerFallingBehind() {
+  TestCapture capture;
+  capture.Start();
+  const int history_blocks =
+      static_cast<int>(capture.ring().history()) / kBlockSize;
+  constexpr int kBlocksBehind = 2 * kBlockCount;
+  for (int i = 0; i < kBlocksBehind * kBlockSize; ++i) {
+    capture.Sample();
+  }
+  HOST_EXPECT_EQ(kBlocksBehind - history_blocks, capture.ring().overruns());
+  HOST_EXPECT_EQ(kBlocksBehind * kBlockSize, capture.ring().high_water());
+  HOST_EXPECT(capture.HistoryIntact());
+
+  const int16_t* samples;
+  HOST_EXPECT(!capture.ring().Peek(0, &samples));
+  HOST_EXPECT_EQ(1, capture.ring().stale_reads());
+  const uint64_t oldest =
+      capture.ring().write_position() - capture.ring().history();
+  HOST_EXPECT(capture.ring().Peek(oldest, &samples));
+  HOST_EXPECT_EQ(RampSample(oldest), samples[0]);
+  HOST_EXPECT_EQ(1, capture.ring().stale_reads());
+
+  const uint32_t overruns = capture.ring().overruns();
+  for (int i = 0; i < 2 * kBlockCount * kBlockSize; ++i) {
+    capture.ring().Consume(capture.ring().write_position());
+    capture.Sample();
+  }
+  HOST_EXPECT_EQ(overruns, capture.ring().overruns());
+}
+
+}  // namespace
+
+int main() {
+  RunHostTest("BlocksCompleteInOrder", TestBlocksCompleteInOrder);
+  RunHostTest("StartedAndEndInterleave", TestStartedAndEndInterleave);
+  RunHostTest("TimestampsStepByBlocks", TestTimestampsStepByBlocks);
+  RunHostTest("LateInterruptLosesNothing", TestLateInterruptLosesNothing);
+  RunHostTest("ConsumerKeepingUp", TestConsumerKeepingUp);
+  RunHostTest("ConsumerFallingBehind", TestConsumerFallingBehind);
+  return HostTestResult();
+}
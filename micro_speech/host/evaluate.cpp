@@ -0,0 +1,669 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Scores the model on a directory of labeled one-second clips laid out like
+// the speech_commands dataset used by model_training/train_model.sh:
+//
+//   DATA_DIR/up/xxxx.wav, DATA_DIR/down/xxxx.wav, DATA_DIR/cat/xxxx.wav, ...
+//
+// Every clip is streamed through the same path as the sketch (a WAV audio
+// source with its simulated capture ring, FeatureProvider, g_model and
+// RecognizeCommands), and the first command the recognizer reports is taken
+// as the prediction, or silence if it reports none. Folders named after a
+// model label score as that label, "_silence_" as silence and every other word
+// as unknown. Each worker thread owns a complete pipeline and pulls clips from
+// a work-stealing pool.
+//
+// Like the sketch, the pipeline is gated by the voice activity detector
+// (voice_activity.h) unless --vad=off. With --vad=both every clip runs with
+// and without it, to measure its effect on accuracy; --lead_ms=MS puts that
+// much silence before each clip, so the detector has gone idle by the time
+// the word starts, as it would have on a device in a quiet room.
+//
+// The audio is streamed into the frontend as in the sketch unless
+// --feed=windows, which hands it each slice's whole window the old way (see
+// FeatureFeed); --feed=both runs every clip both ways, to compare them.
+//
+// The model runs when the sketch's inference scheduler says, under
+// kDefaultInferencePolicy unless --schedule=POLICY (see
+// inference_scheduler.h). --schedule=sweep runs every clip under a range of
+// policies, from every slice to every eighth, and prints the trade-off between
+// inferences per second of audio, how long into a clip commands are reported,
+// and accuracy.
+//
+//   ./build/micro_speech_evaluate --list=DATA_DIR/testing_list.txt DATA_DIR
+//   ./build/micro_speech_evaluate --vad=both --lead_ms=2000 DATA_DIR
+//   ./build/micro_speech_evaluate --feed=both DATA_DIR
+//   ./build/micro_speech_evaluate --schedule=sweep DATA_DIR
+
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "feature_provider.h"
+#include "host_audio_sources.h"
+#include "inference_scheduler.h"
+#include "micro_features_micro_features_generator.h"
+#include "micro_features_micro_model_settings.h"
+#include "micro_features_model.h"
+#include "recognize_commands.h"
+#include "tensor_arena_size.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "voice_activity.h"
+#include "wav_reader.h"
+
+namespace {
+
+
+struct Clip {
+  std::string path;
+  int label;
+};
+
+double NowSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int LabelForDirectory(const std::string& name) {
+  if (name == "_silence_") {
+    return kSilenceIndex;
+  }
+  for (int i = 0; i < kCategoryCount; ++i) {
+    if (name == kCategoryLabels[i]) {
+      return i;
+    }
+  }
+  return kUnknownIndex;
+}
+
+// Collects the clips under `data_dir`, restricted to the paths (relative to
+// `data_dir`) listed in `list_path` if one is given. The background noise
+// recordings aren't one-second clips and are skipped.
+bool FindClips(const std::string& data_dir, const char* list_path,
+               std::vector<Clip>* clips) {
+  namespace fs = std::filesystem;
+  std::set<std::string> wanted;
+  if (list_path != nullptr) {
+    std::ifstream list(list_path);
+    if (!list) {
+      fprintf(stderr, "Couldn't open %s\n", list_path);
+      return false;
+    }
+    std::string line;
+    while (std::getline(list, line)) {
+      if (!line.empty()) {
+        wanted.insert(line);
+      }
+    }
+  }
+  std::error_code error;
+  for (const fs::directory_entry& label_dir :
+       fs::directory_iterator(data_dir, error)) {
+    const std::string label_name = label_dir.path().filename().string();
+    if (!label_dir.is_directory() || (label_name == "_background_noise_")) {
+      continue;
+    }
+    const int label = LabelForDirectory(label_name);
+    for (const fs::directory_entry& file :
+         fs::directory_iterator(label_dir.path())) {
+      if (file.path().extension() != ".wav") {
+        continue;
+      }
+      const std::string relative =
+          label_name + "/" + file.path().filename().string();
+      if (!wanted.empty() && (wanted.count(relative) == 0)) {
+        continue;
+      }
+      clips->push_back({file.path().string(), label});
+    }
+  }
+  if (error) {
+    fprintf(stderr, "Couldn't read %s: %s\n", data_dir.c_str(),
+            error.message().c_str());
+    return false;
+  }
+  // Directory order isn't stable; sorting keeps runs comparable.
+  std::sort(clips->begin(), clips->end(),
+            [](const Clip& a, const Clip& b) { return a.path < b.path; });
+  return true;
+}
+
+// Hands out clip indices. Each worker starts with an equal share in its own
+// deque and takes from the back of it; once that runs dry it steals from the
+// front of the others', so slow clips on one thread don't leave the rest idle.
+class WorkStealingPool {
+ public:
+  WorkStealingPool(int worker_count, int task_count)
+      : queues_(worker_count), locks_(worker_count) {
+    for (int task = 0; task < task_count; ++task) {
+      queues_[task % worker_count].push_back(task);
+    }
+  }
+
+  // Returns false once every task has been taken.
+  bool Next(int worker, int* task, bool* stolen) {
+    {
+      std::lock_guard<std::mutex> lock(locks_[worker]);
+      if (!queues_[worker].empty()) {
+        *task = queues_[worker].back();
+        queues_[worker].pop_back();
+        *stolen = false;
+        return true;
+      }
+    }
+    const int worker_count = static_cast<int>(queues_.size());
+    for (int offset = 1; offset < worker_count; ++offset) {
+      const int victim = (worker + offset) % worker_count;
+      std::lock_guard<std::mutex> lock(locks_[victim]);
+      if (!queues_[victim].empty()) {
+        *task = queues_[victim].front();
+        queues_[victim].pop_front();
+        *stolen = true;
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  std::vector<std::deque<int>> queues_;
+  std::vector<std::mutex> locks_;
+};
+
+// Passes through the loop with new audio that did and didn't run the model.
+struct VadStats {
+  uint64_t passes_run = 0;
+  uint64_t passes_skipped = 0;
+};
+
+// Audio streamed, slices seen and inferences run, and how far into each clip
+// (after the lead) the commands reported were.
+struct ScheduleStats {
+  uint64_t audio_samples = 0;
+  uint64_t slices = 0;
+  uint64_t inferences = 0;
+  std::vector<int> latencies_ms;
+};
+
+// One way of running every clip.
+struct RunMode {
+  bool use_vad;
+  FeatureFeed feed;
+  InferencePolicy policy;
+};
+
+std::string InferencePolicyName(const InferencePolicy& policy) {
+  char name[48];
+  snprintf(name, sizeof(name), "%d,%d,%d,%d",
+           static_cast<int>(policy.idle_interval_slices),
+           static_cast<int>(policy.rising_margin),
+           static_cast<int>(policy.behind_slices),
+           static_cast<int>(policy.max_interval_slices));
+  return name;
+}
+
+std::string RunModeName(const RunMode& mode) {
+  return std::string(mode.use_vad ? "with" : "without") +
+         " voice activity detection, " +
+         (mode.feed == kFeatureFeedStream ? "streamed" : "windowed") +
+         " frontend feed, inference policy " +
+         InferencePolicyName(mode.policy);
+}
+
+// One complete copy of the sketch's pipeline, with its own feature context.
+// The interpreter and its arena are reused across clips; the feature provider
+// and recognizer are rebuilt (and the frontend reinitialized) for each clip so
+// no history leaks from one to the next.
+class ClipPipeline {
+ public:
+  ClipPipeline()
+      : interpreter_(tflite::GetModel(g_model), MakeResolver(), tensor_arena_,
+                     kTensorArenaSize) {}
+
+  ~ClipPipeline() { FreeMicroFeatures(&features_context_); }
+
+  bool Init() {
+    if (interpreter_.AllocateTensors() != kTfLiteOk) {
+      fprintf(stderr, "AllocateTensors() failed\n");
+      return false;
+    }
+    return true;
+  }
+
+  // Streams `lead_samples` of silence, then `samples`, then `tail_samples` of
+  // silence through the pipeline, as `mode` says, and returns the label index
+  // it predicts, or -1 on error. The voice activity gate's counts are added to
+  // `vad_stats`, and the scheduler's and the command's latency to
+  // `schedule_stats`.
+  int Run(const std::vector<int16_t>& samples, int lead_samples,
+          int tail_samples, const RunMode& mode, VadStats* vad_stats,
+          ScheduleStats* schedule_stats) {
+    std::vector<int16_t> padded(lead_samples, 0);
+    padded.insert(padded.end(), samples.begin(), samples.end());
+    padded.resize(padded.size() + tail_samples, 0);
+    audio_source_.LoadSamples(padded.data(), static_cast<int>(padded.size()));
+    audio_source_.Init();
+
+    FeatureProvider<WavAudioSource> feature_provider(
+        &audio_source_, kFeatureElementCount, feature_buffer_,
+        &features_context_, mode.feed);
+    VoiceActivityGate<WavAudioSource> voice_activity_gate(&audio_source_);
+    RecognizeCommands<> recognizer;
+    InferenceScheduler scheduler(mode.policy);
+    int64_t detection_time = 0;
+    const int prediction = Stream(&feature_provider,
+                                  mode.use_vad ? &voice_activity_gate : nullptr,
+                                  &recognizer, &scheduler, &detection_time);
+    vad_stats->passes_run += voice_activity_gate.passes_run();
+    vad_stats->passes_skipped += voice_activity_gate.passes_skipped();
+    InferenceSchedulerStats stats;
+    scheduler.GetStats(&stats);
+    schedule_stats->audio_samples += padded.size();
+    schedule_stats->slices += stats.slices;
+    schedule_stats->inferences += stats.inferences;
+    if ((prediction != kSilenceIndex) && (prediction != kUnknownIndex) &&
+        (detection_time >= lead_samples)) {
+      schedule_stats->latencies_ms.push_back(static_cast<int>(
+          (detection_time - lead_samples) / kAudioSamplesPerMs));
+    }
+    return prediction;
+  }
+
+ private:
+  // The body of the sketch's loop(), run until the audio is used up. The time
+  // a command was reported at goes in `*detection_time`.
+  int Stream(FeatureProvider<WavAudioSource>* feature_provider,
+             VoiceActivityGate<WavAudioSource>* voice_activity_gate,
+             RecognizeCommands<>* recognizer, InferenceScheduler* scheduler,
+             int64_t* detection_time) {
+    TfLiteTensor* model_input = interpreter_.input(0);
+    int64_t previous_time = 0;
+    while (!audio_source_.Finished()) {
+      const int64_t current_time = audio_source_.LatestSampleCount();
+      if ((voice_activity_gate != nullptr) &&
+          !voice_activity_gate->Update(current_time, &previous_time)) {
+        scheduler->Pause();
+        continue;
+      }
+      if ((voice_activity_gate != nullptr) &&
+          voice_activity_gate->window_is_stale()) {
+        feature_provider->ClearFeatureData();
+      }
+      int how_many_new_slices = 0;
+      if (feature_provider->PopulateFeatureData(previous_time, current_time,
+                                                &how_many_new_slices) !=
+          kTfLiteOk) {
+        return -1;
+      }
+      previous_time += how_many_new_slices * kFeatureSliceStrideSamples;
+      if ((how_many_new_slices == 0) ||
+          !scheduler->ShouldInvoke(how_many_new_slices)) {
+        continue;
+      }
+      feature_provider->CopyFeatureData(model_input->data.int8);
+      if (interpreter_.Invoke() != kTfLiteOk) {
+        return -1;
+      }
+      const char* found_command = nullptr;
+      uint8_t score = 0;
+      bool is_new_command = false;
+      if (recognizer->ProcessLatestResults(interpreter_.output(0),
+                                           current_time, &found_command,
+                                           &score, &is_new_command) !=
+          kTfLiteOk) {
+        return -1;
+      }
+      scheduler->RecordResult(recognizer->command_score(),
+                              recognizer->detection_threshold());
+      if (is_new_command) {
+        for (int i = 0; i < kCategoryCount; ++i) {
+          if (found_command == kCategoryLabels[i]) {
+            *detection_time = current_time;
+            return i;
+          }
+        }
+      }
+    }
+    return kSilenceIndex;
+  }
+
+  static const tflite::MicroOpResolver& MakeResolver() {
+    // The resolver only holds registrations, so all pipelines can share it.
+    static tflite::MicroMutableOpResolver<4>* resolver = []() {
+      auto* r = new tflite::MicroMutableOpResolver<4>();
+      r->AddConv2D();
+      r->AddFullyConnected();
+      r->AddSoftmax();
+      r->AddReshape();
+      return r;
+    }();
+    return *resolver;
+  }
+
+  alignas(16) uint8_t tensor_arena_[kTensorArenaSize];
+  WavAudioSource audio_source_;
+  int8_t feature_buffer_[kFeatureElementCount];
+  MicroFeaturesContext features_context_;
+  tflite::MicroInterpreter interpreter_;
+};
+
+struct WorkerStats {
+  int clips = 0;
+  int stolen = 0;
+  int errors = 0;
+  // Per run mode.
+  std::vector<VadStats> vad_stats;
+  std::vector<ScheduleStats> schedule_stats;
+};
+
+// Returns the share of `predictions` that are right, from 0 to 1. Clips that
+// failed (a prediction of -1) aren't scored.
+double Accuracy(const std::vector<Clip>& clips,
+                const std::vector<int>& predictions) {
+  int scored = 0;
+  int correct = 0;
+  for (size_t i = 0; i < clips.size(); ++i) {
+    if (predictions[i] >= 0) {
+      ++scored;
+      correct += (predictions[i] == clips[i].label) ? 1 : 0;
+    }
+  }
+  return scored ? static_cast<double>(correct) / scored : 0.0;
+}
+
+// Prints the confusion matrix and accuracy of `predictions`. Clips that failed
+// (a prediction of -1) aren't scored.
+void PrintScores(const std::vector<Clip>& clips,
+                   const std::vector<int>& predictions) {
+  int confusion[kCategoryCount][kCategoryCount] = {};
+  int scored = 0;
+  int correct = 0;
+  for (size_t i = 0; i < clips.size(); ++i) {
+    if (predictions[i] < 0) {
+      continue;
+    }
+    ++confusion[clips[i].label][predictions[i]];
+    ++scored;
+    correct += (predictions[i] == clips[i].label) ? 1 : 0;
+  }
+
+  printf("confusion matrix (rows: expected, columns: predicted)\n%-10s", "");
+  for (int i = 0; i < kCategoryCount; ++i) {
+    printf(" %9s", kCategoryLabels[i]);
+  }
+  printf("\n");
+  for (int expected = 0; expected < kCategoryCount; ++expected) {
+    printf("%-10s", kCategoryLabels[expected]);
+    for (int predicted = 0; predicted < kCategoryCount; ++predicted) {
+      printf(" %9d", confusion[expected][predicted]);
+    }
+    printf("\n");
+  }
+  printf("accuracy:   %.2f%% (%d of %d)\n",
+         scored ? (correct * 100.0) / scored : 0.0, correct, scored);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const char* list_path = nullptr;
+  const char* data_dir = nullptr;
+  int thread_count = std::max(1u, std::thread::hardware_concurrency());
+  int lead_ms = 0;
+  int tail_ms = 500;
+  int max_clips = 0;
+  // The VAD, feed and inference policy settings to run every clip with, off,
+  // windowed and the most inferences first.
+  std::vector<bool> vad_modes = {true};
+  std::vector<FeatureFeed> feed_modes = {kFeatureFeedStream};
+  std::vector<InferencePolicy> schedule_modes = {kDefaultInferencePolicy};
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], "--list=", 7) == 0) {
+      list_path = argv[i] + 7;
+    } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+      thread_count = std::max(1, atoi(argv[i] + 10));
+    } else if (strncmp(argv[i], "--lead_ms=", 10) == 0) {
+      lead_ms = std::max(0, atoi(argv[i] + 10));
+    } else if (strncmp(argv[i], "--tail_ms=", 10) == 0) {
+      tail_ms = std::max(0, atoi(argv[i] + 10));
+    } else if (strncmp(argv[i], "--max_clips=", 12) == 0) {
+      max_clips = atoi(argv[i] + 12);
+    } else if (strcmp(argv[i], "--vad=on") == 0) {
+      vad_modes = {true};
+    } else if (strcmp(argv[i], "--vad=off") == 0) {
+      vad_modes = {false};
+    } else if (strcmp(argv[i], "--vad=both") == 0) {
+      vad_modes = {false, true};
+    } else if (strcmp(argv[i], "--feed=stream") == 0) {
+      feed_modes = {kFeatureFeedStream};
+    } else if (strcmp(argv[i], "--feed=windows") == 0) {
+      feed_modes = {kFeatureFeedWindows};
+    } else if (strcmp(argv[i], "--feed=both") == 0) {
+      feed_modes = {kFeatureFeedWindows, kFeatureFeedStream};
+    } else if (strcmp(argv[i], "--schedule=sweep") == 0) {
+      // Each idle interval with kScheduledInferencePolicy's rising margin,
+      // and the longer ones again without it, to show what it buys.
+      schedule_modes = {kEverySliceInferencePolicy};
+      for (const char* text : {"2", "3", "4", "6", "8", "4,0", "8,0"}) {
+        InferencePolicy policy;
+        ParseInferencePolicy(text, &policy);
+        schedule_modes.push_back(policy);
+      }
+    } else if (strncmp(argv[i], "--schedule=", 11) == 0) {
+      InferencePolicy policy;
+      if (!ParseInferencePolicy(argv[i] + 11, &policy)) {
+        data_dir = nullptr;
+        break;
+      }
+      schedule_modes = {policy};
+    } else if ((argv[i][0] != '-') && (data_dir == nullptr)) {
+      data_dir = argv[i];
+    } else {
+      data_dir = nullptr;
+      break;
+    }
+  }
+  if (data_dir == nullptr) {
+    fprintf(stderr,
+            "Usage: %s [--list=FILE] [--threads=N] [--lead_ms=MS] "
+            "[--tail_ms=MS] [--max_clips=N] [--vad=on|off|both] "
+            "[--feed=stream|windows|both] [--schedule=POLICY|sweep] "
+            "DATA_DIR\n",
+            argv[0]);
+    return 1;
+  }
+
+  std::vector<Clip> clips;
+  if (!FindClips(data_dir, list_path, &clips)) {
+    return 1;
+  }
+  if ((max_clips > 0) && (static_cast<int>(clips.size()) > max_clips)) {
+    clips.resize(max_clips);
+  }
+  if (clips.empty()) {
+    fprintf(stderr, "No clips found under %s\n", data_dir);
+    return 1;
+  }
+  thread_count = std::min(thread_count, static_cast<int>(clips.size()));
+  printf("Evaluating %zu clips on %d threads\n", clips.size(), thread_count);
+
+  std::vector<RunMode> modes;
+  for (const bool use_vad : vad_modes) {
+    for (const FeatureFeed feed : feed_modes) {
+      for (const InferencePolicy& policy : schedule_modes) {
+        modes.push_back({use_vad, feed, policy});
+      }
+    }
+  }
+  const int mode_count = static_cast<int>(modes.size());
+  const int lead_samples = lead_ms * (kAudioSampleFrequency / 1000);
+  const int tail_samples = tail_ms * (kAudioSampleFrequency / 1000);
+  std::vector<std::vector<int>> predictions(
+      mode_count, std::vector<int>(clips.size(), -1));
+  std::vector<WorkerStats> worker_stats(thread_count);
+  for (WorkerStats& stats : worker_stats) {
+    stats.vad_stats.resize(mode_count);
+    stats.schedule_stats.resize(mode_count);
+  }
+  WorkStealingPool pool(thread_count, static_cast<int>(clips.size()));
+  std::atomic<bool> init_failed(false);
+
+  const double start = NowSeconds();
+  std::vector<std::thread> workers;
+  for (int worker = 0; worker < thread_count; ++worker) {
+    workers.emplace_back([&, worker]() {
+      // ~12KB of arena and buffers; keep it off the thread's stack.
+      std::unique_ptr<ClipPipeline> pipeline(new ClipPipeline());
+      if (!pipeline->Init()) {
+        init_failed = true;
+        return;
+      }
+      WorkerStats& stats = worker_stats[worker];
+      int task;
+      bool stolen;
+      std::vector<int16_t> samples;
+      while (pool.Next(worker, &task, &stolen)) {
+        int sample_rate = 0;
+        if (!ReadWavFile(clips[task].path.c_str(), &samples, &sample_rate) ||
+            (sample_rate != kAudioSampleFrequency)) {
+          ++stats.errors;
+          continue;
+        }
+        for (int mode = 0; mode < mode_count; ++mode) {
+          predictions[mode][task] =
+              pipeline->Run(samples, lead_samples, tail_samples,
+                            modes[mode], &stats.vad_stats[mode],
+                            &stats.schedule_stats[mode]);
+          if (predictions[mode][task] < 0) {
+            ++stats.errors;
+          }
+        }
+        ++stats.clips;
+        stats.stolen += stolen ? 1 : 0;
+      }
+    });
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  const double elapsed = NowSeconds() - start;
+  if (init_failed) {
+    return 1;
+  }
+
+  int errors = 0;
+  int stolen = 0;
+  for (const WorkerStats& stats : worker_stats) {
+    errors += stats.errors;
+    stolen += stats.stolen;
+  }
+  for (int mode = 0; mode < mode_count; ++mode) {
+    printf("\n%s\n", RunModeName(modes[mode]).c_str());
+    PrintScores(clips, predictions[mode]);
+    if (modes[mode].use_vad) {
+      uint64_t passes_run = 0;
+      uint64_t passes_skipped = 0;
+      for (const WorkerStats& stats : worker_stats) {
+        passes_run += stats.vad_stats[mode].passes_run;
+        passes_skipped += stats.vad_stats[mode].passes_skipped;
+      }
+      const uint64_t passes = passes_run + passes_skipped;
+      printf("skipped:    %.1f%% of inferences (%llu of %llu)\n",
+             passes ? (passes_skipped * 100.0) / passes : 0.0,
+             static_cast<unsigned long long>(passes_skipped),
+             static_cast<unsigned long long>(passes));
+    }
+  }
+  if (mode_count == 2) {
+    // How the VAD or the feed changed individual predictions.
+    int lost = 0;
+    int gained = 0;
+    int changed = 0;
+    for (size_t i = 0; i < clips.size(); ++i) {
+      const int before = predictions[0][i];
+      const int after = predictions[1][i];
+      if ((before < 0) || (after < 0) || (before == after)) {
+        continue;
+      }
+      ++changed;
+      lost += (before == clips[i].label) ? 1 : 0;
+      gained += (after == clips[i].label) ? 1 : 0;
+    }
+    printf("\n%s changed %d predictions: %d correct ones lost, %d gained\n",
+           (vad_modes.size() == 2) ? "voice activity detection"
+                                   : "streaming the frontend feed",
+           changed, lost, gained);
+  }
+  if (schedule_modes.size() > 1) {
+    // The trade-off curve: inferences per second of audio (most of the CPU
+    // time that isn't features), when commands are reported, and accuracy.
+    printf("\n%-16s %14s %10s %14s %14s %9s\n", "inference policy",
+           "inferences/s", "% slices", "mean latency", "p90 latency",
+           "accuracy");
+    for (int mode = 0; mode < mode_count; ++mode) {
+      ScheduleStats total;
+      for (const WorkerStats& stats : worker_stats) {
+        const ScheduleStats& schedule = stats.schedule_stats[mode];
+        total.audio_samples += schedule.audio_samples;
+        total.slices += schedule.slices;
+        total.inferences += schedule.inferences;
+        total.latencies_ms.insert(total.latencies_ms.end(),
+                                  schedule.latencies_ms.begin(),
+                                  schedule.latencies_ms.end());
+      }
+      std::sort(total.latencies_ms.begin(), total.latencies_ms.end());
+      double mean_latency_ms = 0.0;
+      for (const int latency_ms : total.latencies_ms) {
+        mean_latency_ms += latency_ms;
+      }
+      const size_t latency_count = total.latencies_ms.size();
+      if (latency_count > 0) {
+        mean_latency_ms /= latency_count;
+      }
+      const int p90_latency_ms =
+          (latency_count > 0) ? total.latencies_ms[(latency_count * 9) / 10]
+                              : 0;
+      const double audio_seconds =
+          total.audio_samples / static_cast<double>(kAudioSampleFrequency);
+      printf("%-16s %14.1f %9.1f%% %12.0fms %12dms %8.2f%%\n",
+             InferencePolicyName(modes[mode].policy).c_str(),
+             audio_seconds > 0 ? total.inferences / audio_seconds : 0.0,
+             total.slices ? (total.inferences * 100.0) / total.slices : 0.0,
+             mean_latency_ms, p90_latency_ms,
+             Accuracy(clips, predictions[mode]) * 100.0);
+    }
+  }
+  printf("\nerrors:     %d\n", errors);
+  printf("throughput: %.1f clips/s (%.3f s, %d clips stolen)\n",
+         clips.size() / elapsed, elapsed, stolen);
+  return 0;
+}
@@ -0,0 +1,113 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "host_audio_sources.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "micro_features_micro_model_settings.h"
+#include "wav_reader.h"
+
+bool WavAudioSource::LoadWav(const char* path) {
+  int sample_rate = 0;
+  std::vector<int16_t> samples;
+  if (!ReadWavFile(path, &samples, &sample_rate)) {
+    return false;
+  }
+  if (sample_rate != kAudioSampleFrequency) {
+    fprintf(stderr, "%s is sampled at %dHz, the model needs %dHz\n", path,
+            sample_rate, kAudioSampleFrequency);
+    return false;
+  }
+  StopRealtime();
+  samples_.swap(samples);
+  Restart();
+  return true;
+}
+
+void WavAudioSource::LoadSamples(const int16_t* samples, int count) {
+  StopRealtime();
+  samples_.assign(samples, samples + count);
+  Restart();
+}
+
+void WavAudioSource::Restart() {
+  StopRealtime();
+  position_ = 0;
+  Rewind();
+}
+
+void WavAudioSource::ReadBlock(int16_t* block, int count) {
+  size_t available = 0;
+  if (position_ < samples_.size()) {
+    available = std::min(samples_.size() - position_,
+                         static_cast<size_t>(count));
+    std::copy_n(samples_.data() + position_, available, block);
+  }
+  std::fill(block + available, block + count, 0);
+  position_ += count;
+}
+
+void RawStreamAudioSource::Restart() {
+  StopRealtime();
+  if (fseek(stream_, 0, SEEK_SET) != 0) {
+    fprintf(stderr, "Can't rewind the audio stream\n");
+  }
+  clearerr(stream_);
+  at_end_ = false;
+  Rewind();
+}
+
+void RawStreamAudioSource::ReadBlock(int16_t* block, int count) {
+  // The stream is little-endian, like every host this builds on.
+  const size_t read = fread(block, sizeof(int16_t), count, stream_);
+  if (read < static_cast<size_t>(count)) {
+    std::fill(block + read, block + count, 0);
+    at_end_ = true;
+  }
+}
+
+void SyntheticAudioSource::Restart() {
+  StopRealtime();
+  position_ = 0;
+  noise_state_ = seed_;
+  Rewind();
+}
+
+void SyntheticAudioSource::ReadBlock(int16_t* block, int count) {
+  const double phase_step = 2.0 * M_PI * tone_hz_ / kAudioSampleFrequency;
+  for (int i = 0; i < count; ++i, ++position_) {
+    if (position_ >= duration_samples_) {
+      block[i] = 0;
+      continue;
+    }
+    int32_t value = static_cast<int32_t>(
+        std::lround(tone_amplitude_ * std::sin(phase_step * position_)));
+    if (noise_amplitude_ > 0) {
+      // xorshift32, uniform over [-noise_amplitude_, noise_amplitude_].
+      noise_state_ ^= noise_state_ << 13;
+      noise_state_ ^= noise_state_ >> 17;
+      noise_state_ ^= noise_state_ << 5;
+      value += static_cast<int32_t>(noise_state_ %
+                                    (2 * noise_amplitude_ + 1)) -
+               noise_amplitude_;
+    }
+    block[i] = static_cast<int16_t>(
+        std::min<int32_t>(std::max<int32_t>(value, INT16_MIN), INT16_MAX));
+  }
+}
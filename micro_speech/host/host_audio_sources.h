@@ -0,0 +1,282 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_HOST_AUDIO_SOURCES_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_HOST_AUDIO_SOURCES_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "audio_source.h"
+#include "block_capture.h"
+#include "simulated_saadc.h"
+
+// Audio sources for running the sketch on a Linux host.
+//
+// Instead of a timer interrupt, every call to LatestSampleCount() "captures"
+// the next block of samples from the source into the same kind of ring buffer
+// the device uses, so the pipeline runs as fast as the CPU allows while seeing
+// the audio exactly as the board would. The samples go through a simulated
+// SAADC (simulated_saadc.h) driven by the same BlockCapture logic as the
+// firmware's DMA interrupt, into the same AudioRing. Each source object holds
+// all of its state, so several threads can each stream their own audio through
+// their own pipeline.
+
+// Number of samples delivered per simulated capture block. This matches the
+// block size the device firmware uses to advance its sample count.
+constexpr int kHostCaptureBlockSize = 512;
+
+// The capture machinery shared by the host sources. `Derived` supplies the
+// audio with:
+//   void ReadBlock(int16_t* block, int count);
+//     Fills `block` with the next `count` samples, padding with silence past
+//     the end of the audio.
+//   bool AtEnd() const;
+//     True once all of the audio has been read.
+template <typename Derived>
+class HostAudioSource : public AudioSource<Derived> {
+ public:
+  ~HostAudioSource() { StopRealtime(); }
+
+  // True once every sample of the source has been delivered to the ring.
+  bool Finished() const { return is_finished_.load(std::memory_order_acquire); }
+
+  // Switches to real-time capture: a producer thread, standing in for the
+  // capture interrupt, delivers a block every 32ms divided by `speed`, whether
+  // or not the pipeline keeps up. Overruns then show up in GetStats() exactly
+  // as they would on the device.
+  void StartRealtime(double speed) {
+    StopRealtime();
+    stop_producer_.store(false, std::memory_order_relaxed);
+    producer_ = std::thread(RunProducer, this, speed);
+  }
+
+  // Stops the producer thread, if any.
+  void StopRealtime() {
+    if (IsRealtime()) {
+      stop_producer_.store(true, std::memory_order_relaxed);
+      producer_.join();
+    }
+  }
+
+  // AudioSource hooks.
+  TfLiteStatus StartCapture() {
+    // Like the firmware, don't return until the first block has arrived.
+    if (IsRealtime()) {
+      WaitForCapture(0);
+    } else if (this->ring().write_position() == 0) {
+      CaptureBlock();
+    }
+    return kTfLiteOk;
+  }
+
+  int64_t Capture() {
+    if (!IsRealtime() && !Finished()) {
+      CaptureBlock();
+    }
+    return this->ring().write_position();
+  }
+
+  // In real time, a condition variable the producer thread notifies after
+  // each block stands in for the device's wait-for-event. Otherwise the next
+  // Capture() produces the block, so there's nothing to wait for.
+  void WaitForCapture(int64_t sample_count) {
+    if (!IsRealtime()) {
+      return;
+    }
+    std::unique_lock<std::mutex> lock(capture_mutex_);
+    capture_ready_.wait(lock, [this, sample_count] {
+      return (static_cast<int64_t>(this->ring().write_position()) >
+              sample_count) ||
+             Finished();
+    });
+  }
+
+ protected:
+  HostAudioSource()
+      : AudioSource<Derived>(2 * kHostCaptureBlockSize),
+        block_capture_(&saadc_, this->ring().data(), kHostCaptureBlockSize,
+                       kAudioCaptureBufferSize / kHostCaptureBlockSize) {}
+
+  // Starts capture over with an empty ring, for when the derived source has
+  // been pointed at the beginning of its audio. Call Init() again afterwards.
+  void Rewind() {
+    StopRealtime();
+    this->ring().Reset();
+    saadc_.Reset();
+    block_capture_.Start();
+    HandleInterrupt();
+    this->set_started(false);
+    is_finished_.store(derived()->AtEnd(), std::memory_order_release);
+  }
+
+ private:
+  Derived* derived() { return static_cast<Derived*>(this); }
+
+  bool IsRealtime() const { return producer_.joinable(); }
+
+  // Mirrors SaadcAudioSource::HandleInterrupt().
+  void HandleInterrupt() {
+    if (saadc_.events_end) {
+      saadc_.events_end = false;
+      block_capture_.OnEnd();
+      this->ring().Commit(kHostCaptureBlockSize);
+    }
+    if (saadc_.events_started) {
+      saadc_.events_started = false;
+      block_capture_.OnStarted();
+    }
+  }
+
+  // Stands in for the sampling timer: feeds the next block of the source
+  // through the simulated SAADC, servicing its interrupt as the device would.
+  void CaptureBlock() {
+    int16_t block[kHostCaptureBlockSize];
+    derived()->ReadBlock(block, kHostCaptureBlockSize);
+    for (int i = 0; i < kHostCaptureBlockSize; ++i) {
+      saadc_.Sample(block[i]);
+      if (saadc_.interrupt_pending()) {
+        HandleInterrupt();
+      }
+    }
+    if (derived()->AtEnd()) {
+      is_finished_.store(true, std::memory_order_release);
+    }
+  }
+
+  // Delivers a block every 32ms divided by `speed` until the source runs out.
+  static void RunProducer(HostAudioSource* source, double speed) {
+    using Clock = std::chrono::steady_clock;
+    const auto block_duration = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(
+            (kHostCaptureBlockSize /
+             static_cast<double>(kAudioSampleFrequency)) /
+            speed));
+    auto next_block = Clock::now();
+    while (!source->stop_producer_.load(std::memory_order_relaxed) &&
+           !source->Finished()) {
+      next_block += block_duration;
+      std::this_thread::sleep_until(next_block);
+      source->CaptureBlock();
+      source->SignalCapture();
+    }
+  }
+
+  // Wakes WaitForCapture(). Taking the lock, even with nothing to change
+  // under it, means a waiter is either already asleep or yet to check the
+  // ring, so the notification can't fall between the two.
+  void SignalCapture() {
+    { std::lock_guard<std::mutex> lock(capture_mutex_); }
+    capture_ready_.notify_all();
+  }
+
+  SimulatedSaadc saadc_;
+  BlockCapture<SimulatedSaadc> block_capture_;
+  // Set once every source sample has been delivered.
+  std::atomic<bool> is_finished_{true};
+  // The thread standing in for the capture interrupt in real-time mode.
+  std::thread producer_;
+  std::atomic<bool> stop_producer_{false};
+  // Signalled by the producer thread after each block.
+  std::mutex capture_mutex_;
+  std::condition_variable capture_ready_;
+};
+
+// Plays back audio held in memory, usually loaded from a WAV file.
+class WavAudioSource : public HostAudioSource<WavAudioSource> {
+ public:
+  WavAudioSource() { Rewind(); }
+
+  // Loads a 16-bit PCM WAV file at kAudioSampleFrequency as the audio,
+  // starting capture over. Returns false on error.
+  bool LoadWav(const char* path);
+
+  // Uses `count` samples starting at `samples` as the audio, starting capture
+  // over. The samples are copied.
+  void LoadSamples(const int16_t* samples, int count);
+
+  // Starts capture over from the beginning of the same audio.
+  void Restart();
+
+  int sample_count() const { return static_cast<int>(samples_.size()); }
+
+  void ReadBlock(int16_t* block, int count);
+  bool AtEnd() const { return position_ >= samples_.size(); }
+
+ private:
+  std::vector<int16_t> samples_;
+  size_t position_ = 0;
+};
+
+// Reads raw 16-bit little-endian mono PCM at kAudioSampleFrequency from a
+// stream, stdin by default, for example from
+//   arecord -f S16_LE -r 16000 -c 1 -t raw
+class RawStreamAudioSource : public HostAudioSource<RawStreamAudioSource> {
+ public:
+  explicit RawStreamAudioSource(FILE* stream = stdin) : stream_(stream) {
+    Rewind();
+  }
+
+  // Seeks back to the start of the stream, if it can, and starts capture over.
+  void Restart();
+
+  void ReadBlock(int16_t* block, int count);
+  bool AtEnd() const { return at_end_; }
+
+ private:
+  FILE* stream_;
+  bool at_end_ = false;
+};
+
+// Generates `duration_samples` of a sine tone plus uniform white noise, for
+// exercising the pipeline without any recordings. Amplitudes are in sample
+// units, and the noise is the same for the same seed.
+class SyntheticAudioSource : public HostAudioSource<SyntheticAudioSource> {
+ public:
+  SyntheticAudioSource(int64_t duration_samples, double tone_hz,
+                       int tone_amplitude, int noise_amplitude,
+                       uint32_t seed = 1)
+      : duration_samples_(duration_samples),
+        tone_hz_(tone_hz),
+        tone_amplitude_(tone_amplitude),
+        noise_amplitude_(noise_amplitude),
+        seed_(seed),
+        noise_state_(seed) {
+    Rewind();
+  }
+
+  // Starts capture over from the beginning of the same signal.
+  void Restart();
+
+  void ReadBlock(int16_t* block, int count);
+  bool AtEnd() const { return position_ >= duration_samples_; }
+
+ private:
+  const int64_t duration_samples_;
+  const double tone_hz_;
+  const int tone_amplitude_;
+  const int noise_amplitude_;
+  const uint32_t seed_;
+  uint32_t noise_state_;
+  int64_t position_ = 0;
+};
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_HOST_AUDIO_SOURCES_H_
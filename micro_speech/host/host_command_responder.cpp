@@ -0,0 +1,42 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "host_command_responder.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+#include "command_responder.h"
+
+namespace {
+int g_detection_count = 0;
+int g_inference_count = 0;
+}  // namespace
+
+// There are no LEDs or USB keyboard on the host, so detected commands are
+// simply printed.
+void RespondToCommand(int64_t current_time_ms, const char* found_command,
+                      uint8_t score, bool is_new_command) {
+  ++g_inference_count;
+  if (is_new_command) {
+    ++g_detection_count;
+    printf("Heard %s (%d) @%" PRId64 "ms\n", found_command, score,
+           current_time_ms);
+  }
+}
+
+int HostDetectionCount() { return g_detection_count; }
+
+int HostInferenceCount() { return g_inference_count; }
@@ -0,0 +1,251 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Runs the micro_speech sketch's setup() and loop() on a Linux host, fed from
+// a WAV file instead of the microphone, as fast as the CPU allows. Prints the
+// detected commands, the latency distribution of each stage of loop() and the
+// real-time factor (processing time divided by audio duration).
+//
+// With --profile_out=FILE the stage histograms are also written in the same
+// binary record format the device sends over serial, for profile_decode.
+//
+// With --realtime[=SPEED] a producer thread delivers the audio at SPEED times
+// real time (default 1), like the capture interrupt on the device, instead of
+// whenever loop() asks for it. The capture buffer statistics then show whether
+// the loop kept up.
+//
+// The summary includes how many inferences the voice activity gate skipped,
+// and how many slices the inference scheduler ran the model on. With
+// --schedule=POLICY the scheduler uses POLICY instead of the sketch's default,
+// written as ParseInferencePolicy() takes it, e.g. --schedule=4,60 or
+// --schedule=every (see inference_scheduler.h).
+//
+// With --dump_features=FILE every feature slice computed for the clip is
+// written to FILE as raw int8 values, kFeatureSliceSize per slice, so changes
+// to the audio or feature path can be checked for identical output with cmp.
+//
+// With --snapshot=FILE the sketch restores its pipeline state from FILE, if a
+// previous run saved one there, and saves it back every second of audio and at
+// the end, as the device does in retained RAM (see pipeline_snapshot.h).
+
+#include <time.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "feature_provider.h"
+#include "host_audio_sources.h"
+#include "host_command_responder.h"
+#include "main_functions.h"
+#include "micro_features_micro_features_generator.h"
+#include "micro_features_micro_model_settings.h"
+#include "host_snapshot_store.h"
+#include "inference_scheduler.h"
+#include "pipeline_snapshot.h"
+#include "sketch_audio_source.h"
+#include "stage_profiler.h"
+#include "voice_activity.h"
+
+namespace {
+
+double NowSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void WriteToFile(const uint8_t* data, size_t size, void* context) {
+  fwrite(data, 1, size, static_cast<FILE*>(context));
+}
+
+// Streams `wav_path` through a source and FeatureProvider of its own, stepping
+// time the way loop() does, and writes each new slice to `path`.
+bool DumpFeatures(const char* wav_path, const char* path) {
+  WavAudioSource audio_source;
+  if (!audio_source.LoadWav(wav_path)) {
+    return false;
+  }
+  FILE* file = fopen(path, "wb");
+  if (file == nullptr) {
+    fprintf(stderr, "Couldn't write %s\n", path);
+    return false;
+  }
+  static int8_t feature_buffer[kFeatureElementCount];
+  MicroFeaturesContext context;
+  FeatureProvider<WavAudioSource> feature_provider(
+      &audio_source, kFeatureElementCount, feature_buffer, &context,
+      kFeatureFeedStream);
+  bool ok = (audio_source.Init() == kTfLiteOk);
+  int64_t previous_time = 0;
+  while (ok && !audio_source.Finished()) {
+    const int64_t current_time = audio_source.LatestSampleCount();
+    int how_many_new_slices = 0;
+    if (feature_provider.PopulateFeatureData(previous_time, current_time,
+                                             &how_many_new_slices) !=
+        kTfLiteOk) {
+      fprintf(stderr, "Feature generation failed\n");
+      ok = false;
+      break;
+    }
+    previous_time += how_many_new_slices * kFeatureSliceStrideSamples;
+    const int new_slices = (how_many_new_slices < kFeatureSliceCount)
+                               ? how_many_new_slices
+                               : kFeatureSliceCount;
+    for (int i = kFeatureSliceCount - new_slices; i < kFeatureSliceCount;
+         ++i) {
+      fwrite(feature_provider.SliceData(i), 1, kFeatureSliceSize, file);
+    }
+  }
+  FreeMicroFeatures(&context);
+  fclose(file);
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const char* wav_path = nullptr;
+  const char* profile_path = nullptr;
+  const char* features_path = nullptr;
+  const char* snapshot_path = nullptr;
+  double realtime_speed = 0.0;
+  const char* schedule = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], "--profile_out=", 14) == 0) {
+      profile_path = argv[i] + 14;
+    } else if (strncmp(argv[i], "--dump_features=", 16) == 0) {
+      features_path = argv[i] + 16;
+    } else if (strncmp(argv[i], "--snapshot=", 11) == 0) {
+      snapshot_path = argv[i] + 11;
+    } else if (strncmp(argv[i], "--schedule=", 11) == 0) {
+      schedule = argv[i] + 11;
+    } else if (strcmp(argv[i], "--realtime") == 0) {
+      realtime_speed = 1.0;
+    } else if (strncmp(argv[i], "--realtime=", 11) == 0) {
+      realtime_speed = atof(argv[i] + 11);
+      if (realtime_speed <= 0.0) {
+        wav_path = nullptr;
+        break;
+      }
+    } else if ((argv[i][0] != '-') && (wav_path == nullptr)) {
+      wav_path = argv[i];
+    } else {
+      wav_path = nullptr;
+      break;
+    }
+  }
+  if (wav_path == nullptr) {
+    fprintf(stderr,
+            "Usage: %s [--profile_out=FILE] [--dump_features=FILE] "
+            "[--snapshot=FILE] [--schedule=POLICY] [--realtime[=SPEED]] "
+            "<16kHz mono 16-bit file.wav>\n",
+            argv[0]);
+    return 1;
+  }
+  if (features_path != nullptr) {
+    if (!DumpFeatures(wav_path, features_path)) {
+      return 1;
+    }
+  }
+  if (schedule != nullptr) {
+    InferencePolicy policy;
+    if (!ParseInferencePolicy(schedule, &policy) ||
+        (SetSketchInferencePolicy(policy) != kTfLiteOk)) {
+      fprintf(stderr, "Bad --schedule policy %s\n", schedule);
+      return 1;
+    }
+  }
+  SketchAudioSource* audio_source = GetSketchAudioSource();
+  if (!audio_source->LoadWav(wav_path)) {
+    return 1;
+  }
+  if (realtime_speed > 0.0) {
+    audio_source->StartRealtime(realtime_speed);
+  }
+
+  SetHostSnapshotPath(snapshot_path);
+  const double start = NowSeconds();
+  setup();
+  const double setup_done = NowSeconds();
+  int loops = 0;
+  while (!audio_source->Finished()) {
+    loop();
+    ++loops;
+  }
+  const double end = NowSeconds();
+  SaveSketchSnapshot();
+  const int idle_permille = audio_source->idle_meter().idle_permille();
+  audio_source->StopRealtime();
+  AudioCaptureStats capture_stats;
+  audio_source->GetStats(&capture_stats);
+
+  const double audio_seconds = audio_source->sample_count() /
+                               static_cast<double>(kAudioSampleFrequency);
+  const double loop_seconds = end - setup_done;
+  printf("\n");
+  ProfilerPrintSummary();
+  printf("\n");
+  printf("audio:       %.3f s\n", audio_seconds);
+  printf("setup():     %.3f ms\n", (setup_done - start) * 1e3);
+  printf("loop():      %d calls, %d inferences, %.3f ms\n", loops,
+         HostInferenceCount(), loop_seconds * 1e3);
+  printf("detections:  %d\n", HostDetectionCount());
+  if (snapshot_path != nullptr) {
+    printf("snapshot:    %s %s\n",
+           SketchSnapshotRestored() ? "restored from and saved to"
+                                    : "none to restore, saved to",
+           snapshot_path);
+  }
+  uint32_t passes_run = 0;
+  uint32_t passes_skipped = 0;
+  GetVoiceActivityStats(&passes_run, &passes_skipped);
+  const uint32_t passes = passes_run + passes_skipped;
+  printf("vad:         %u of %u inferences skipped (%.1f%%)\n",
+         passes_skipped, passes,
+         passes ? (passes_skipped * 100.0) / passes : 0.0);
+  InferenceSchedulerStats schedule_stats;
+  GetInferenceSchedulerStats(&schedule_stats);
+  printf("scheduler:   %u of %u slices run (%.1f%%), %u rising, "
+         "%u passes behind, interval %d slices\n",
+         schedule_stats.inferences, schedule_stats.slices,
+         schedule_stats.slices
+             ? (schedule_stats.inferences * 100.0) / schedule_stats.slices
+             : 0.0,
+         schedule_stats.rising_inferences, schedule_stats.behind_passes,
+         static_cast<int>(schedule_stats.interval_slices));
+  printf("idle:        %d.%d%% of the time waiting for audio\n",
+         idle_permille / 10, idle_permille % 10);
+  printf("capture:     %llu samples, %u overruns, %u stale reads, "
+         "high water %u of %u samples\n",
+         static_cast<unsigned long long>(capture_stats.samples_captured),
+         capture_stats.overruns, capture_stats.stale_reads,
+         capture_stats.high_water, capture_stats.capacity);
+  if (audio_seconds > 0) {
+    printf("real-time factor: %.5f (%.1fx faster than real time)\n",
+           loop_seconds / audio_seconds, audio_seconds / loop_seconds);
+  }
+
+  if (profile_path != nullptr) {
+    FILE* profile_file = fopen(profile_path, "wb");
+    if (profile_file == nullptr) {
+      fprintf(stderr, "Couldn't write %s\n", profile_path);
+      return 1;
+    }
+    ProfilerDump(WriteToFile, profile_file);
+    fclose(profile_file);
+  }
+  return 0;
+}
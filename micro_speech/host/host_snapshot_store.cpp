@@ -0,0 +1,71 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "host_snapshot_store.h"
+
+#include <cstdio>
+#include <string>
+
+#include "snapshot_store.h"
+
+namespace {
+
+constexpr int kSnapshotRecordCapacity = 16 * 1024;
+
+const char* g_path = nullptr;
+alignas(8) uint8_t g_record[kSnapshotRecordCapacity];
+int g_record_size = 0;
+
+}  // namespace
+
+void SetHostSnapshotPath(const char* path) { g_path = path; }
+
+void* SnapshotRecord(int size) {
+  if (size > kSnapshotRecordCapacity) {
+    return nullptr;
+  }
+  if (g_record_size == 0) {
+    g_record_size = size;
+    FILE* file = (g_path != nullptr) ? fopen(g_path, "rb") : nullptr;
+    if (file != nullptr) {
+      // A short or missing file leaves the rest zeroed, which no snapshot
+      // passes for valid.
+      fread(g_record, 1, size, file);
+      fclose(file);
+    }
+  }
+  return g_record;
+}
+
+void SaveSnapshotRecord() {
+  if ((g_path == nullptr) || (g_record_size == 0)) {
+    return;
+  }
+  // Written beside it and renamed over it, so a crash mid-write leaves the
+  // previous snapshot.
+  const std::string temp_path = std::string(g_path) + ".tmp";
+  FILE* file = fopen(temp_path.c_str(), "wb");
+  if (file == nullptr) {
+    fprintf(stderr, "Couldn't write %s\n", temp_path.c_str());
+    return;
+  }
+  const bool ok =
+      (fwrite(g_record, 1, g_record_size, file) ==
+       static_cast<size_t>(g_record_size));
+  if ((fclose(file) != 0) || !ok ||
+      (rename(temp_path.c_str(), g_path) != 0)) {
+    fprintf(stderr, "Couldn't write %s\n", g_path);
+  }
+}
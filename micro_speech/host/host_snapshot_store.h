@@ -0,0 +1,25 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_HOST_SNAPSHOT_STORE_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_HOST_SNAPSHOT_STORE_H_
+
+// Keeps the sketch's snapshot record (see snapshot_store.h) in the file at
+// `path`, read when the record is first asked for and rewritten by each
+// SaveSnapshotRecord(). Without a path, nothing is read or written, as on a
+// board without retained memory. Call before setup().
+void SetHostSnapshotPath(const char* path);
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_HOST_SNAPSHOT_STORE_H_
@@ -0,0 +1,67 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_HOST_TEST_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_HOST_TEST_H_
+
+#include <cstdio>
+
+// The bare minimum for the host tests, which are plain programs `make test`
+// builds and runs: each test is a function that checks its expectations with
+// HOST_EXPECT() and HOST_EXPECT_EQ(), main() runs them with RunHostTest(), and
+// the program exits with HostTestResult(), non-zero if anything failed.
+// Failed expectations print where they are and carry on; both macros return
+// whether the expectation held, so a loop can stop at its first failure.
+
+inline int& HostTestFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define HOST_EXPECT(condition)                                              \
+  ((condition) ? true                                                       \
+               : (fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, \
+                          #condition),                                      \
+                  ++HostTestFailures(), false))
+
+#define HOST_EXPECT_EQ(expected, actual)                                  \
+  HostExpectEq((expected), (actual), #expected, #actual, __FILE__, __LINE__)
+
+// Compares two integers of any type by value.
+template <typename Expected, typename Actual>
+bool HostExpectEq(const Expected& expected, const Actual& actual,
+                  const char* expected_text, const char* actual_text,
+                  const char* file, int line) {
+  if (static_cast<long long>(expected) == static_cast<long long>(actual)) {
+    return true;
+  }
+  fprintf(stderr, "%s:%d: %s is %lld, expected %s (%lld)\n", file, line,
+          actual_text, static_cast<long long>(actual), expected_text,
+          static_cast<long long>(expected));
+  ++HostTestFailures();
+  return false;
+}
+
+// Runs `test` and prints whether it passed.
+inline void RunHostTest(const char* name, void (*test)()) {
+  const int failures_before = HostTestFailures();
+  test();
+  printf("%-48s %s\n", name,
+         (HostTestFailures() == failures_before) ? "ok" : "FAILED");
+}
+
+inline int HostTestResult() { return (HostTestFailures() == 0) ? 0 : 1; }
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_HOST_TEST_H_
@@ -0,0 +1,40 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "micro_features_reference.h"
+
+#include "feature_quantizer.h"
+#include "tensorflow/lite/experimental/microfrontend/lib/frontend.h"
+#include "tensorflow/lite/micro/micro_log.h"
+
+TfLiteStatus GenerateMicroFeaturesReference(MicroFeaturesContext* context,
+                                            const int16_t* input,
+                                            int input_size, int output_size,
+                                            int8_t* output,
+                                            size_t* num_samples_read) {
+  if (output_size < context->state.filterbank.num_channels) {
+    MicroPrintf("Feature output is %d values, expected %d", output_size,
+                context->state.filterbank.num_channels);
+    return kTfLiteError;
+  }
+  FrontendOutput frontend_output = FrontendProcessSamples(
+      &context->state, input, input_size, num_samples_read);
+
+  for (size_t i = 0; i < frontend_output.size; ++i) {
+    output[i] = QuantizeFeatureReference(frontend_output.values[i]);
+  }
+
+  return kTfLiteOk;
+}
@@ -0,0 +1,35 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_MICRO_FEATURES_REFERENCE_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_MICRO_FEATURES_REFERENCE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "micro_features_micro_features_generator.h"
+#include "tensorflow/lite/c/common.h"
+
+// The features GenerateMicroFeatures() makes, computed the original way, with
+// FrontendProcessSamples() and a division per value. Only the host tools use
+// it: pipeline_test checks GenerateMicroFeatures() against it, and the
+// benchmark times both.
+TfLiteStatus GenerateMicroFeaturesReference(MicroFeaturesContext* context,
+                                            const int16_t* input,
+                                            int input_size, int output_size,
+                                            int8_t* output,
+                                            size_t* num_samples_read);
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_MICRO_FEATURES_REFERENCE_H_
@@ -0,0 +1,633 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks that each optimized stage of the pipeline computes exactly what the
+// code it replaced did, on the clip `make test` passes it or one given on the
+// command line. micro_speech_benchmark only times these stages; this is what
+// makes the timings worth comparing. Needs TFLM:
+//
+//   make test
+//   ./build/pipeline_test ../data/yes_1000ms.wav
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "audio_conditioner.h"
+#include "feature_provider.h"
+#include "feature_quantizer.h"
+#include "host_audio_sources.h"
+#include "host_test.h"
+#include "micro_features_micro_features_generator.h"
+#include "micro_features_micro_model_settings.h"
+#include "micro_features_reference.h"
+#include "micro_features_model.h"
+#include "pipeline_snapshot.h"
+#include "recognize_commands.h"
+#include "streaming_conv.h"
+#include "tensor_arena_size.h"
+#include "tensorflow/lite/micro/kernels/conv.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "voice_activity.h"
+#include "wav_reader.h"
+
+namespace {
+
+alignas(16) uint8_t g_tensor_arena[kTensorArenaSize];
+alignas(16) uint8_t g_streaming_tensor_arena[kTensorArenaSize];
+alignas(8) uint8_t g_streaming_conv_workspace
+    [TinyConvStreamingWorkspaceSize<DefaultModelSettings>()];
+
+// Set up by main() for the tests: the clip, and the model with the stock and
+// with the streaming convolution.
+std::vector<int16_t> g_wav_samples;
+tflite::MicroInterpreter* g_interpreter = nullptr;
+tflite::MicroInterpreter* g_streaming_interpreter = nullptr;
+
+// Advances a xorshift32 generator and returns its next value, so the
+// pseudo-random inputs are the same on every run.
+uint32_t NextRandom(uint32_t* state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+// Runs ConditionAudioBlock() and ConditionAudioBlockReference() side by side
+// over pseudo-random codes, including ones outside the 12-bit range, with a
+// few coefficient sets, and returns how many outputs differ.
+int64_t CompareAudioConditioners() {
+  constexpr int kBlocks = 2000;
+  const int16_t coefficient_sets[][2] = {
+      {kAudioConditionerDefaultPole, kAudioConditionerDefaultGain},
+      {16383, 32767},
+      {0, 16384},
+      {12000, 1},
+  };
+  uint32_t state = 12345;
+  int64_t mismatches = 0;
+  for (const auto& coefficients : coefficient_sets) {
+    AudioConditioner kernel;
+    AudioConditioner reference;
+    InitAudioConditioner(&kernel, coefficients[0], coefficients[1]);
+    InitAudioConditioner(&reference, coefficients[0], coefficients[1]);
+    alignas(4) int16_t kernel_samples[kHostCaptureBlockSize];
+    int16_t reference_samples[kHostCaptureBlockSize];
+    for (int block = 0; block < kBlocks; ++block) {
+      for (int i = 0; i < kHostCaptureBlockSize; ++i) {
+        const uint32_t random = NextRandom(&state);
+        // Mostly in-range codes, with every eighth block full scale.
+        kernel_samples[i] = static_cast<int16_t>(
+            ((block % 8) == 0) ? random : (random % 4200) - 50);
+        reference_samples[i] = kernel_samples[i];
+      }
+      ConditionAudioBlock(&kernel, kernel_samples, kHostCaptureBlockSize);
+      ConditionAudioBlockReference(&reference, reference_samples,
+                                   kHostCaptureBlockSize);
+      for (int i = 0; i < kHostCaptureBlockSize; ++i) {
+        mismatches += (kernel_samples[i] != reference_samples[i]);
+      }
+    }
+  }
+  return mismatches;
+}
+
+// Quantizes every uint16 value with QuantizeFeature() and QuantizeFeatures()
+// and returns how many results differ from QuantizeFeatureReference().
+int64_t CompareFeatureQuantizers() {
+  constexpr int kValueCount = UINT16_MAX + 1;
+  static uint16_t values[kValueCount];
+  static int8_t features[kValueCount];
+  for (int value = 0; value < kValueCount; ++value) {
+    values[value] = static_cast<uint16_t>(value);
+  }
+  QuantizeFeatures(values, kValueCount, features);
+  int64_t mismatches = 0;
+  for (int value = 0; value < kValueCount; ++value) {
+    const int8_t expected = QuantizeFeatureReference(values[value]);
+    mismatches += (QuantizeFeature(values[value]) != expected);
+    mismatches += (features[value] != expected);
+  }
+  return mismatches;
+}
+
+// Streams `samples` through GenerateMicroFeatures() and
+// GenerateMicroFeaturesReference(), each with its own context, at a few gains
+// so the log sees quiet and clipped input too, and returns how many features
+// differ.
+int64_t CompareFeatureGenerators(const int16_t* samples, int sample_count) {
+  MicroFeaturesContext context;
+  MicroFeaturesContext reference_context;
+  if ((InitializeMicroFeatures(&context) != kTfLiteOk) ||
+      (InitializeMicroFeatures(&reference_context) != kTfLiteOk)) {
+    return -1;
+  }
+  int64_t mismatches = 0;
+  std::vector<int16_t> scaled(sample_count);
+  for (const int32_t gain_q4 : {16, 1, 64, 16}) {
+    for (int i = 0; i < sample_count; ++i) {
+      const int32_t sample = (samples[i] * gain_q4) / 16;
+      scaled[i] = static_cast<int16_t>(
+          std::min<int32_t>(INT16_MAX, std::max<int32_t>(INT16_MIN, sample)));
+    }
+    for (int start = 0;
+         start + kFeatureSliceDurationSamples <= sample_count;
+         start += kFeatureSliceStrideSamples) {
+      int8_t features[kFeatureSliceSize];
+      int8_t reference_features[kFeatureSliceSize];
+      size_t num_samples_read;
+      GenerateMicroFeatures(&context, scaled.data() + start,
+                            kFeatureSliceDurationSamples, kFeatureSliceSize,
+                            features, &num_samples_read);
+      GenerateMicroFeaturesReference(
+          &reference_context, scaled.data() + start,
+          kFeatureSliceDurationSamples, kFeatureSliceSize, reference_features,
+          &num_samples_read);
+      for (int i = 0; i < kFeatureSliceSize; ++i) {
+        mismatches += (features[i] != reference_features[i]);
+      }
+    }
+  }
+  FreeMicroFeatures(&context);
+  FreeMicroFeatures(&reference_context);
+  return mismatches;
+}
+
+// Streams `samples` through a FeatureProvider with `feed`, stepping time the
+// way loop() does, and compares every slice it makes with the frontend fed
+// the whole clip in one go, the way the training pipeline computes features.
+// Returns how many features differ, and adds how many were compared to
+// `feature_count`.
+int64_t CompareFeedWithContiguousFrontend(const std::vector<int16_t>& samples,
+                                          FeatureFeed feed,
+                                          int64_t* feature_count) {
+  MicroFeaturesContext reference_context;
+  if (InitializeMicroFeatures(&reference_context) != kTfLiteOk) {
+    return -1;
+  }
+  std::vector<int8_t> reference;
+  int8_t slice[kFeatureSliceSize];
+  for (size_t offset = 0; offset < samples.size();) {
+    size_t num_samples_read;
+    bool has_slice;
+    StreamMicroFeatures(&reference_context, samples.data() + offset,
+                        static_cast<int>(samples.size() - offset), slice,
+                        &num_samples_read, &has_slice);
+    offset += num_samples_read;
+    if (has_slice) {
+      reference.insert(reference.end(), slice, slice + kFeatureSliceSize);
+    }
+  }
+  FreeMicroFeatures(&reference_context);
+
+  WavAudioSource source;
+  source.LoadSamples(samples.data(), static_cast<int>(samples.size()));
+  static int8_t feature_buffer[kFeatureElementCount];
+  MicroFeaturesContext context;
+  FeatureProvider<WavAudioSource> feature_provider(
+      &source, kFeatureElementCount, feature_buffer, &context, feed);
+  int how_many_new_slices = 0;
+  feature_provider.PopulateFeatureData(0, 0, &how_many_new_slices);
+  source.Init();
+  int64_t mismatches = 0;
+  size_t next_slice = 0;
+  int64_t previous_time = 0;
+  while (!source.Finished()) {
+    const int64_t current_time = source.LatestSampleCount();
+    how_many_new_slices = 0;
+    if (feature_provider.PopulateFeatureData(previous_time, current_time,
+                                             &how_many_new_slices) !=
+        kTfLiteOk) {
+      mismatches = -1;
+      break;
+    }
+    previous_time += how_many_new_slices * kFeatureSliceStrideSamples;
+    // One block of audio is never more than a window's worth of slices. The
+    // silence padding the last block may make a slice the reference lacks.
+    for (int i = kFeatureSliceCount - how_many_new_slices;
+         (i < kFeatureSliceCount) &&
+         (next_slice < reference.size() / kFeatureSliceSize);
+         ++i, ++next_slice) {
+      const int8_t* expected =
+          reference.data() + (next_slice * kFeatureSliceSize);
+      for (int j = 0; j < kFeatureSliceSize; ++j) {
+        mismatches += (feature_provider.SliceData(i)[j] != expected[j]);
+      }
+      *feature_count += kFeatureSliceSize;
+    }
+  }
+  FreeMicroFeatures(&context);
+  return mismatches;
+}
+
+// Pushes `samples` into the frontend in pseudo-random runs of up to most of a
+// window's worth of slices through StreamMicroFeatureSlices(), and one slice
+// at a time through StreamMicroFeatures(), and returns how many features
+// differ.
+int64_t CompareBatchedSlices(const std::vector<int16_t>& samples) {
+  MicroFeaturesContext context;
+  MicroFeaturesContext reference_context;
+  if ((InitializeMicroFeatures(&context) != kTfLiteOk) ||
+      (InitializeMicroFeatures(&reference_context) != kTfLiteOk)) {
+    return -1;
+  }
+  static int8_t ring[kFeatureElementCount];
+  int slot = 0;
+  int8_t reference[kFeatureSliceSize];
+  size_t reference_offset = 0;
+  uint32_t state = 12345;
+  int64_t mismatches = 0;
+  for (size_t offset = 0; offset < samples.size();) {
+    // Short enough that no run makes more slices than the ring holds.
+    const int run = std::min<int>(
+        1 + NextRandom(&state) %
+                ((kFeatureSliceCount - 1) * kFeatureSliceStrideSamples),
+        samples.size() - offset);
+    int slices_made = 0;
+    StreamMicroFeatureSlices(&context, samples.data() + offset, run, ring,
+                             kFeatureSliceCount, &slot, &slices_made);
+    offset += run;
+    for (int i = slices_made; i > 0; --i) {
+      bool has_slice = false;
+      while (!has_slice && (reference_offset < samples.size())) {
+        size_t num_samples_read;
+        StreamMicroFeatures(&reference_context,
+                            samples.data() + reference_offset,
+                            samples.size() - reference_offset, reference,
+                            &num_samples_read, &has_slice);
+        reference_offset += num_samples_read;
+      }
+      const int8_t* batched =
+          ring + ((slot - i + kFeatureSliceCount) % kFeatureSliceCount) *
+                     kFeatureSliceSize;
+      for (int j = 0; j < kFeatureSliceSize; ++j) {
+        mismatches += (batched[j] != reference[j]);
+      }
+    }
+  }
+  FreeMicroFeatures(&context);
+  FreeMicroFeatures(&reference_context);
+  return mismatches;
+}
+
+// Runs `samples` through a FeatureProvider and RecognizeCommands as loop()
+// does, and halfway through snapshots them and restores the snapshot into a
+// second pair with a frontend context of its own, which then carries on
+// alongside the first on the same clock. The recognizers are fed scores made
+// up from the newest slice, written into `results`. Returns how many features
+// and recognizer answers differ after the restore.
+int64_t CompareRestoredPipeline(const std::vector<int16_t>& samples,
+                                TfLiteTensor* results) {
+  WavAudioSource source;
+  source.LoadSamples(samples.data(), static_cast<int>(samples.size()));
+  static int8_t feature_buffer[kFeatureElementCount];
+  static int8_t restored_feature_buffer[kFeatureElementCount];
+  MicroFeaturesContext context;
+  MicroFeaturesContext restored_context;
+  FeatureProvider<WavAudioSource> feature_provider(
+      &source, kFeatureElementCount, feature_buffer, &context,
+      kFeatureFeedStream);
+  FeatureProvider<WavAudioSource> restored_feature_provider(
+      &source, kFeatureElementCount, restored_feature_buffer,
+      &restored_context, kFeatureFeedStream);
+  RecognizeCommands<> recognizer;
+  RecognizeCommands<> restored_recognizer;
+  static PipelineSnapshot<> snapshot;
+  int how_many_new_slices = 0;
+  feature_provider.PopulateFeatureData(0, 0, &how_many_new_slices);
+  source.Init();
+  const int64_t restore_time = static_cast<int64_t>(samples.size()) / 2;
+  bool is_restored = false;
+  int64_t mismatches = 0;
+  int64_t previous_time = 0;
+  while ((mismatches >= 0) && !source.Finished()) {
+    const int64_t current_time = source.LatestSampleCount();
+    if (!is_restored && (current_time >= restore_time)) {
+      TakePipelineSnapshot(feature_provider, recognizer, current_time,
+                           &snapshot);
+      if (RestorePipelineSnapshot(snapshot, current_time,
+                                  &restored_feature_provider,
+                                  &restored_recognizer) != kTfLiteOk) {
+        mismatches = -1;
+        break;
+      }
+      is_restored = true;
+    }
+    how_many_new_slices = 0;
+    int restored_new_slices = 0;
+    if ((feature_provider.PopulateFeatureData(previous_time, current_time,
+                                              &how_many_new_slices) !=
+         kTfLiteOk) ||
+        (is_restored && ((restored_feature_provider.PopulateFeatureData(
+                              previous_time, current_time,
+                              &restored_new_slices) != kTfLiteOk) ||
+                         (restored_new_slices != how_many_new_slices)))) {
+      mismatches = -1;
+      break;
+    }
+    previous_time += how_many_new_slices * kFeatureSliceStrideSamples;
+    if (how_many_new_slices == 0) {
+      continue;
+    }
+    const int8_t* newest_slice =
+        feature_provider.SliceData(kFeatureSliceCount - 1);
+    for (int i = 0; i < kCategoryCount; ++i) {
+      results->data.int8[i] = newest_slice[(i * 7) % kFeatureSliceSize];
+    }
+    const char* found_command = nullptr;
+    uint8_t score = 0;
+    bool is_new_command = false;
+    recognizer.ProcessLatestResults(results, current_time, &found_command,
+                                    &score, &is_new_command);
+    if (!is_restored) {
+      continue;
+    }
+    const char* restored_found_command = nullptr;
+    uint8_t restored_score = 0;
+    bool restored_is_new_command = false;
+    restored_recognizer.ProcessLatestResults(
+        results, current_time, &restored_found_command, &restored_score,
+        &restored_is_new_command);
+    mismatches += (restored_found_command != found_command) +
+                  (restored_score != score) +
+                  (restored_is_new_command != is_new_command);
+    for (int i = 0; i < kFeatureSliceCount; ++i) {
+      mismatches += (memcmp(restored_feature_provider.SliceData(i),
+                            feature_provider.SliceData(i),
+                            kFeatureSliceSize) != 0);
+    }
+  }
+  // A corrupted record must not pass for a snapshot.
+  snapshot.features.features[kFeatureElementCount / 2] ^= 1;
+  if (IsValidPipelineSnapshot(snapshot)) {
+    mismatches = -1;
+  }
+  FreeMicroFeatures(&context);
+  FreeMicroFeatures(&restored_context);
+  return is_restored ? mismatches : -1;
+}
+
+// Runs `samples`, then `gap_samples` of digital silence, then `samples` again,
+// through a VoiceActivityGate and a FeatureProvider as loop() does, and
+// returns how many slices older than those computed when the gate reopens
+// after the silence aren't zeroes, or -1 if it never says the window is stale.
+int64_t CountStaleSlices(const std::vector<int16_t>& samples,
+                         int gap_samples) {
+  std::vector<int16_t> clip(samples);
+  clip.insert(clip.end(), gap_samples, 0);
+  clip.insert(clip.end(), samples.begin(), samples.end());
+  WavAudioSource source;
+  source.LoadSamples(clip.data(), static_cast<int>(clip.size()));
+  static int8_t feature_buffer[kFeatureElementCount];
+  MicroFeaturesContext context;
+  FeatureProvider<WavAudioSource> feature_provider(
+      &source, kFeatureElementCount, feature_buffer, &context,
+      kFeatureFeedStream);
+  VoiceActivityGate<WavAudioSource> voice_activity_gate(&source);
+  int how_many_new_slices = 0;
+  feature_provider.PopulateFeatureData(0, 0, &how_many_new_slices);
+  source.Init();
+  int64_t stale_slices = -1;
+  int64_t previous_time = 0;
+  while ((stale_slices < 0) && !source.Finished()) {
+    const int64_t current_time = source.LatestSampleCount();
+    if (!voice_activity_gate.Update(current_time, &previous_time)) {
+      continue;
+    }
+    const bool is_stale = voice_activity_gate.window_is_stale();
+    if (is_stale) {
+      feature_provider.ClearFeatureData();
+    }
+    how_many_new_slices = 0;
+    if (feature_provider.PopulateFeatureData(previous_time, current_time,
+                                             &how_many_new_slices) !=
+        kTfLiteOk) {
+      break;
+    }
+    previous_time += how_many_new_slices * kFeatureSliceStrideSamples;
+    if (!is_stale) {
+      continue;
+    }
+    stale_slices = 0;
+    for (int i = 0; i < kFeatureSliceCount - how_many_new_slices; ++i) {
+      const int8_t* slice = feature_provider.SliceData(i);
+      stale_slices += std::any_of(slice, slice + kFeatureSliceSize,
+                                  [](int8_t value) { return value != 0; });
+    }
+  }
+  FreeMicroFeatures(&context);
+  return stale_slices;
+}
+
+// The features of `samples` played `repeats` times over, slice after slice.
+std::vector<int8_t> StreamFeatureSlices(const std::vector<int16_t>& samples,
+                                        int repeats) {
+  std::vector<int8_t> slices;
+  MicroFeaturesContext context;
+  if (InitializeMicroFeatures(&context) != kTfLiteOk) {
+    return slices;
+  }
+  int8_t slice[kFeatureSliceSize];
+  for (int i = 0; i < repeats; ++i) {
+    for (size_t offset = 0; offset < samples.size();) {
+      size_t num_samples_read;
+      bool has_slice = false;
+      StreamMicroFeatures(&context, samples.data() + offset,
+                          samples.size() - offset, slice, &num_samples_read,
+                          &has_slice);
+      offset += num_samples_read;
+      if (has_slice) {
+        slices.insert(slices.end(), slice, slice + kFeatureSliceSize);
+      }
+    }
+  }
+  FreeMicroFeatures(&context);
+  return slices;
+}
+
+// Slides a window over `slices` a pseudo-random one to three slices at a
+// time, now and then staying put or jumping further as after skipped
+// inferences, and runs each window through `full`, with the stock
+// convolution, and `streaming`, with the streaming one checking its cache.
+// Returns how many scores and reused convolution rows differ.
+int64_t CompareStreamingInvokes(const std::vector<int8_t>& slices,
+                                tflite::MicroInterpreter* full,
+                                tflite::MicroInterpreter* streaming) {
+  const int slice_count = static_cast<int>(slices.size()) / kFeatureSliceSize;
+  StreamingConvStats before;
+  GetStreamingConvStats(&before);
+  SetStreamingConvChecking(true);
+  uint32_t state = 12345;
+  int64_t mismatches = 0;
+  for (int start = 0; start + kFeatureSliceCount <= slice_count;) {
+    const int8_t* window = slices.data() + (start * kFeatureSliceSize);
+    memcpy(full->input(0)->data.int8, window, kFeatureElementCount);
+    memcpy(streaming->input(0)->data.int8, window, kFeatureElementCount);
+    if ((full->Invoke() != kTfLiteOk) || (streaming->Invoke() != kTfLiteOk)) {
+      mismatches = -1;
+      break;
+    }
+    const TfLiteTensor* full_output = full->output(0);
+    const TfLiteTensor* streaming_output = streaming->output(0);
+    for (size_t i = 0; i < full_output->bytes; ++i) {
+      mismatches +=
+          (full_output->data.int8[i] != streaming_output->data.int8[i]);
+    }
+    const int roll = static_cast<int>(NextRandom(&state) % 32);
+    if (roll < 14) {
+      start += 1;
+    } else if (roll < 24) {
+      start += 2;
+    } else if (roll < 28) {
+      start += 3;
+    } else if (roll >= 30) {
+      start += (kFeatureSliceCount / 2) + roll;
+    }
+  }
+  SetStreamingConvChecking(false);
+  StreamingConvStats after;
+  GetStreamingConvStats(&after);
+  if ((mismatches >= 0) && (after.rows_reused == before.rows_reused)) {
+    fprintf(stderr, "The streaming convolution never reused a row\n");
+    return -1;
+  }
+  return (mismatches < 0) ? mismatches
+                          : mismatches + (after.rows_mismatched -
+                                          before.rows_mismatched);
+}
+
+// ConditionAudioBlock() matches the plain C filter bit for bit.
+void TestAudioConditionerMatchesReference() {
+  HOST_EXPECT_EQ(0, CompareAudioConditioners());
+}
+
+// QuantizeFeature() and QuantizeFeatures() match the division on every
+// possible log value.
+void TestFeatureQuantizerMatchesReference() {
+  HOST_EXPECT_EQ(0, CompareFeatureQuantizers());
+}
+
+// The fused frontend makes the same features as the original on every slice
+// of the clip.
+void TestFeatureGeneratorMatchesReference() {
+  HOST_EXPECT_EQ(0, CompareFeatureGenerators(
+                        g_wav_samples.data(),
+                        static_cast<int>(g_wav_samples.size())));
+}
+
+// The streamed feed makes exactly the features the training pipeline would.
+// The windowed one never did, so only micro_speech_evaluate --feed=both
+// reports on it.
+void TestStreamedFeedMatchesContiguousFrontend() {
+  int64_t feature_count = 0;
+  HOST_EXPECT_EQ(0, CompareFeedWithContiguousFrontend(
+                        g_wav_samples, kFeatureFeedStream, &feature_count));
+  HOST_EXPECT(feature_count > 0);
+}
+
+// StreamMicroFeatureSlices() makes the same features as pushing the audio in
+// a slice at a time.
+void TestBatchedSlicesMatchOneAtATime() {
+  HOST_EXPECT_EQ(0, CompareBatchedSlices(g_wav_samples));
+}
+
+// A pipeline restored from a snapshot carries on exactly like the one it was
+// taken from, and a corrupted snapshot is rejected.
+void TestRestoredPipelineCarriesOn() {
+  HOST_EXPECT_EQ(0, CompareRestoredPipeline(g_wav_samples,
+                                            g_interpreter->output(0)));
+}
+
+// When speech resumes after more than a window of silence, the slices from
+// before it are cleared rather than joined to the pre-roll.
+void TestGateClearsStaleWindow() {
+  HOST_EXPECT_EQ(0, CountStaleSlices(g_wav_samples,
+                                     3 * kAudioSampleFrequency));
+}
+
+// The streaming convolution makes the same scores as the stock one on a
+// sliding window, and every row it reuses matches a fresh computation.
+void TestStreamingConvMatchesStock() {
+  const std::vector<int8_t> slices = StreamFeatureSlices(g_wav_samples, 8);
+  if (!HOST_EXPECT(static_cast<int>(slices.size()) / kFeatureSliceSize >
+                   kFeatureSliceCount)) {
+    return;
+  }
+  HOST_EXPECT_EQ(0, CompareStreamingInvokes(slices, g_interpreter,
+                                            g_streaming_interpreter));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const char* wav_path = "../data/yes_1000ms.wav";
+  if (argc > 2) {
+    fprintf(stderr, "Usage: %s [file.wav]\n", argv[0]);
+    return 1;
+  }
+  if (argc == 2) {
+    wav_path = argv[1];
+  }
+  int sample_rate;
+  if (!ReadWavFile(wav_path, &g_wav_samples, &sample_rate)) {
+    return 1;
+  }
+
+  // The sketch's model, with the stock convolution and with the streaming one.
+  const tflite::Model* model = tflite::GetModel(g_model);
+  static tflite::MicroMutableOpResolver<4> micro_op_resolver;
+  // TFLM's own CONV_2D, which the streaming one has to match.
+  micro_op_resolver.AddConv2D(tflite::Register_CONV_2D());
+  micro_op_resolver.AddFullyConnected();
+  micro_op_resolver.AddSoftmax();
+  micro_op_resolver.AddReshape();
+  static tflite::MicroInterpreter interpreter(model, micro_op_resolver,
+                                              g_tensor_arena, kTensorArenaSize);
+  SetStreamingConvWorkspace(g_streaming_conv_workspace,
+                            sizeof(g_streaming_conv_workspace));
+  static tflite::MicroMutableOpResolver<4> streaming_op_resolver;
+  streaming_op_resolver.AddConv2D(Register_STREAMING_CONV_2D());
+  streaming_op_resolver.AddFullyConnected();
+  streaming_op_resolver.AddSoftmax();
+  streaming_op_resolver.AddReshape();
+  static tflite::MicroInterpreter streaming_interpreter(
+      model, streaming_op_resolver, g_streaming_tensor_arena,
+      kTensorArenaSize);
+  if ((interpreter.AllocateTensors() != kTfLiteOk) ||
+      (streaming_interpreter.AllocateTensors() != kTfLiteOk)) {
+    fprintf(stderr, "AllocateTensors() failed\n");
+    return 1;
+  }
+  g_interpreter = &interpreter;
+  g_streaming_interpreter = &streaming_interpreter;
+
+  RunHostTest("AudioConditionerMatchesReference",
+              TestAudioConditionerMatchesReference);
+  RunHostTest("FeatureQuantizerMatchesReference",
+              TestFeatureQuantizerMatchesReference);
+  RunHostTest("FeatureGeneratorMatchesReference",
+              TestFeatureGeneratorMatchesReference);
+  RunHostTest("StreamedFeedMatchesContiguousFrontend",
+              TestStreamedFeedMatchesContiguousFrontend);
+  RunHostTest("BatchedSlicesMatchOneAtATime", TestBatchedSlicesMatchOneAtATime);
+  RunHostTest("RestoredPipelineCarriesOn", TestRestoredPipelineCarriesOn);
+  RunHostTest("GateClearsStaleWindow", TestGateClearsStaleWindow);
+  RunHostTest("StreamingConvMatchesStock", TestStreamingConvMatchesStock);
+  return HostTestResult();
+}
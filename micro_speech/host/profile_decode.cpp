@@ -0,0 +1,103 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Decodes the per-stage latency records written by ProfilerDump() into
+// percentile tables. The input can be a raw capture of the device's serial
+// port (any text printed around the records is skipped) or a file written by
+// micro_speech_host --profile_out. For example:
+//
+//   stty -F /dev/ttyACM0 raw && cat /dev/ttyACM0 > capture.bin &
+//   printf '\x10' > /dev/ttyACM0
+//   ./build/profile_decode capture.bin
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "stage_profiler.h"
+
+namespace {
+
+void PrintRecord(int index, uint32_t tick_frequency,
+                 const ProfilerHistogram histograms[kStageCount]) {
+  const double ticks_per_us = tick_frequency / 1e6;
+  printf("record %d (%.1f MHz tick)\n", index, tick_frequency / 1e6);
+  printf("%-10s %10s %10s %10s %10s %10s %10s\n", "stage", "calls", "mean us",
+         "p50 us", "p90 us", "p99 us", "max us");
+  for (int stage = 0; stage < kStageCount; ++stage) {
+    const ProfilerHistogram& histogram = histograms[stage];
+    const double mean =
+        histogram.count
+            ? static_cast<double>(histogram.total_ticks) / histogram.count
+            : 0.0;
+    printf("%-10s %10u %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+           ProfilerStageName(stage), histogram.count, mean / ticks_per_us,
+           ProfilerPercentile(histogram, 50) / ticks_per_us,
+           ProfilerPercentile(histogram, 90) / ticks_per_us,
+           ProfilerPercentile(histogram, 99) / ticks_per_us,
+           histogram.max_ticks / ticks_per_us);
+  }
+  printf("idle: %.1f%% of the loop's time\n",
+         ProfilerIdleShare(histograms) * 100.0);
+  printf("\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc > 2) {
+    fprintf(stderr, "Usage: %s [capture file, default stdin]\n", argv[0]);
+    return 1;
+  }
+  FILE* file = (argc == 2) ? fopen(argv[1], "rb") : stdin;
+  if (file == nullptr) {
+    fprintf(stderr, "Couldn't open %s\n", argv[1]);
+    return 1;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t read;
+  while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    data.insert(data.end(), chunk, chunk + read);
+  }
+  if (file != stdin) {
+    fclose(file);
+  }
+
+  int records = 0;
+  int corrupt = 0;
+  static ProfilerHistogram histograms[kStageCount];
+  for (size_t offset = 0; offset + 4 <= data.size(); ++offset) {
+    if (memcmp(&data[offset], "SPRF", 4) != 0) {
+      continue;
+    }
+    uint32_t tick_frequency = 0;
+    if (ProfilerParseRecord(&data[offset], data.size() - offset,
+                            &tick_frequency, histograms)) {
+      PrintRecord(records++, tick_frequency, histograms);
+      offset += kProfilerRecordSize - 1;
+    } else {
+      ++corrupt;
+    }
+  }
+  if (corrupt > 0) {
+    fprintf(stderr, "Skipped %d truncated or corrupt records\n", corrupt);
+  }
+  if (records == 0) {
+    fprintf(stderr, "No profile records found\n");
+    return 1;
+  }
+  return 0;
+}
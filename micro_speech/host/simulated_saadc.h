@@ -0,0 +1,79 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_SIMULATED_SAADC_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_SIMULATED_SAADC_H_
+
+#include <cstdint>
+
+// A software model of the parts of the nRF52 SAADC that BlockCapture relies
+// on, so the host build drives the same DMA ping-pong as the firmware.
+//
+// RESULT.PTR and RESULT.MAXCNT are double buffered: Start() (the START task)
+// latches them and raises STARTED, and SetBuffer() only changes what the next
+// START picks up. Each Sample() (the SAMPLE task) is written through the
+// latched pointer; when MAXCNT samples have been written it raises END and,
+// like the firmware's END->START PPI channel, immediately starts again.
+class SimulatedSaadc {
+ public:
+  // Matches SaadcAudioSource::Hal in saadc_audio_source.h.
+  void SetBuffer(int16_t* buffer, uint32_t sample_count) {
+    pending_buffer_ = buffer;
+    pending_count_ = sample_count;
+  }
+
+  void Start() {
+    buffer_ = pending_buffer_;
+    count_ = pending_count_;
+    amount_ = 0;
+    events_started = true;
+  }
+
+  // Converts one sample. Samples taken before the first START are dropped,
+  // as on the device.
+  void Sample(int16_t value) {
+    if (buffer_ == nullptr || amount_ >= count_) {
+      return;
+    }
+    buffer_[amount_] = value;
+    amount_ += 1;
+    if (amount_ == count_) {
+      events_end = true;
+      Start();
+    }
+  }
+
+  bool interrupt_pending() const { return events_started || events_end; }
+
+  // RESULT.PTR as the last START latched it, which samples are written
+  // through, and as the next START will latch it.
+  const int16_t* buffer() const { return buffer_; }
+  const int16_t* pending_buffer() const { return pending_buffer_; }
+
+  void Reset() { *this = SimulatedSaadc(); }
+
+  // Event registers, cleared by the interrupt handler.
+  bool events_started = false;
+  bool events_end = false;
+
+ private:
+  int16_t* pending_buffer_ = nullptr;
+  uint32_t pending_count_ = 0;
+  int16_t* buffer_ = nullptr;
+  uint32_t count_ = 0;
+  uint32_t amount_ = 0;
+};
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_SIMULATED_SAADC_H_
@@ -0,0 +1,306 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "streaming_conv.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/kernels/internal/reference/integer_ops/conv.h"
+#include "tensorflow/lite/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/kernels/conv.h"
+#include "tensorflow/lite/micro/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/micro_context.h"
+#include "tensorflow/lite/micro/micro_log.h"
+
+namespace {
+
+struct OpData {
+  // First, so ConvPrepare() can fill it in.
+  tflite::OpDataConv conv;
+  bool streaming;
+};
+
+// The one convolution streaming, and its state in the workspace.
+struct StreamingState {
+  uint8_t* workspace;
+  int workspace_size;
+  const OpData* owner;
+  bool checking;
+  StreamingConvStats stats;
+
+  // Carved out of the workspace when the owner is prepared.
+  int64_t* row_positions;
+  int8_t* rows;
+  int8_t* last_input;
+  int8_t* check_row;
+  int slot_count;
+  int input_bytes;
+  int output_row_bytes;
+
+  // The stream position of the window's first row, counting every row any
+  // window has started at since the workspace was set.
+  int64_t window_position;
+  bool has_last_input;
+};
+
+StreamingState g_state = {};
+
+// Computes output rows [first_row, last_row) into `rows_output`, by running
+// the reference kernel over just the input rows they read, with the padding
+// moved to match.
+void ComputeRows(const tflite::ConvParams& params, const OpData& data,
+                 const tflite::RuntimeShape& input_shape,
+                 const int8_t* input_data,
+                 const tflite::RuntimeShape& filter_shape,
+                 const int8_t* filter_data,
+                 const tflite::RuntimeShape& bias_shape,
+                 const int32_t* bias_data,
+                 const tflite::RuntimeShape& output_shape, int first_row,
+                 int last_row, int8_t* rows_output) {
+  const int input_height = input_shape.Dims(1);
+  const int band_start =
+      (first_row * params.stride_height) - params.padding_values.height;
+  const int first_input_row = std::max(0, band_start);
+  tflite::ConvParams rows_params = params;
+  rows_params.padding_values.height =
+      static_cast<int16_t>(first_input_row - band_start);
+  const int32_t rows_input_dims[4] = {1, input_height - first_input_row,
+                                      input_shape.Dims(2), input_shape.Dims(3)};
+  const int32_t rows_output_dims[4] = {1, last_row - first_row,
+                                       output_shape.Dims(2),
+                                       output_shape.Dims(3)};
+  tflite::reference_integer_ops::ConvPerChannel(
+      rows_params, data.conv.per_channel_output_multiplier,
+      data.conv.per_channel_output_shift,
+      tflite::RuntimeShape(4, rows_input_dims),
+      input_data +
+          (first_input_row * input_shape.Dims(2) * input_shape.Dims(3)),
+      filter_shape, filter_data, bias_shape, bias_data,
+      tflite::RuntimeShape(4, rows_output_dims), rows_output);
+}
+
+void* StreamingConvInit(TfLiteContext* context, const char* /*buffer*/,
+                        size_t /*length*/) {
+  TFLITE_DCHECK(context->AllocatePersistentBuffer != nullptr);
+  return context->AllocatePersistentBuffer(context, sizeof(OpData));
+}
+
+TfLiteStatus StreamingConvPrepare(TfLiteContext* context, TfLiteNode* node) {
+  TF_LITE_ENSURE_OK(context, tflite::ConvPrepare(context, node));
+  OpData* data = static_cast<OpData*>(node->user_data);
+  data->streaming = false;
+
+  tflite::MicroContext* micro_context = tflite::GetMicroContext(context);
+  TfLiteTensor* input =
+      micro_context->AllocateTempInputTensor(node, tflite::kConvInputTensor);
+  TfLiteTensor* filter =
+      micro_context->AllocateTempInputTensor(node, tflite::kConvWeightsTensor);
+  TfLiteTensor* output =
+      micro_context->AllocateTempOutputTensor(node, tflite::kConvOutputTensor);
+  TF_LITE_ENSURE(context, input != nullptr && filter != nullptr &&
+                              output != nullptr);
+  const bool is_int8 = (input->type == kTfLiteInt8) &&
+                       (filter->type == kTfLiteInt8) &&
+                       (output->type == kTfLiteInt8);
+  const int input_height = input->dims->data[1];
+  const int input_row_bytes = input->dims->data[2] * input->dims->data[3];
+  const int filter_height = filter->dims->data[1];
+  const int output_row_bytes = output->dims->data[2] * output->dims->data[3];
+  const bool is_single_batch = (input->dims->data[0] == 1);
+  micro_context->DeallocateTempTfLiteTensor(input);
+  micro_context->DeallocateTempTfLiteTensor(filter);
+  micro_context->DeallocateTempTfLiteTensor(output);
+  if (!is_int8) {
+    MicroPrintf("The streaming CONV_2D kernel only handles int8");
+    return kTfLiteError;
+  }
+
+  const auto* params = static_cast<const TfLiteConvParams*>(node->builtin_data);
+  if ((g_state.workspace == nullptr) || (g_state.owner != nullptr) ||
+      !is_single_batch || (params->dilation_height_factor != 1) ||
+      (filter_height > input_height)) {
+    return kTfLiteOk;
+  }
+  const int needed = StreamingConvWorkspaceSize(
+      input_height, input_row_bytes, filter_height, output_row_bytes);
+  if (needed > g_state.workspace_size) {
+    MicroPrintf(
+        "The streaming CONV_2D kernel needs %d bytes of workspace, not %d, "
+        "so is computing every row",
+        needed, g_state.workspace_size);
+    return kTfLiteOk;
+  }
+
+  g_state.slot_count = input_height - filter_height + 1;
+  g_state.input_bytes = input_height * input_row_bytes;
+  g_state.output_row_bytes = output_row_bytes;
+  uint8_t* next = g_state.workspace;
+  g_state.row_positions = reinterpret_cast<int64_t*>(next);
+  next += g_state.slot_count * sizeof(int64_t);
+  g_state.rows = reinterpret_cast<int8_t*>(next);
+  next += g_state.slot_count * output_row_bytes;
+  g_state.last_input = reinterpret_cast<int8_t*>(next);
+  next += g_state.input_bytes;
+  g_state.check_row = reinterpret_cast<int8_t*>(next);
+  for (int i = 0; i < g_state.slot_count; ++i) {
+    g_state.row_positions[i] = -1;
+  }
+  g_state.window_position = 0;
+  g_state.has_last_input = false;
+  g_state.owner = data;
+  data->streaming = true;
+  return kTfLiteOk;
+}
+
+TfLiteStatus StreamingConvEval(TfLiteContext* context, TfLiteNode* node) {
+  const auto& params =
+      *static_cast<const TfLiteConvParams*>(node->builtin_data);
+  const OpData& data = *static_cast<const OpData*>(node->user_data);
+  const TfLiteEvalTensor* input =
+      tflite::micro::GetEvalInput(context, node, tflite::kConvInputTensor);
+  const TfLiteEvalTensor* filter =
+      tflite::micro::GetEvalInput(context, node, tflite::kConvWeightsTensor);
+  const TfLiteEvalTensor* bias =
+      (tflite::NumInputs(node) == 3)
+          ? tflite::micro::GetEvalInput(context, node, tflite::kConvBiasTensor)
+          : nullptr;
+  TfLiteEvalTensor* output =
+      tflite::micro::GetEvalOutput(context, node, tflite::kConvOutputTensor);
+
+  const tflite::ConvParams conv_params =
+      tflite::ConvParamsQuantized(params, data.conv);
+  const tflite::RuntimeShape input_shape = tflite::micro::GetTensorShape(input);
+  const tflite::RuntimeShape filter_shape =
+      tflite::micro::GetTensorShape(filter);
+  const tflite::RuntimeShape bias_shape = tflite::micro::GetTensorShape(bias);
+  const tflite::RuntimeShape output_shape =
+      tflite::micro::GetTensorShape(output);
+  const int8_t* input_data = tflite::micro::GetTensorData<int8_t>(input);
+  const int8_t* filter_data = tflite::micro::GetTensorData<int8_t>(filter);
+  const int32_t* bias_data =
+      tflite::micro::GetOptionalTensorData<int32_t>(bias);
+  int8_t* output_data = tflite::micro::GetTensorData<int8_t>(output);
+  const int output_height = output_shape.Dims(1);
+
+  if (!data.streaming || (g_state.owner != &data)) {
+    ComputeRows(conv_params, data, input_shape, input_data, filter_shape,
+                filter_data, bias_shape, bias_data, output_shape, 0,
+                output_height, output_data);
+    return kTfLiteOk;
+  }
+
+  // The window slid by the smallest shift that leaves every row it shares
+  // with the last one unchanged; if there's none it's all new. Any shift that
+  // matches keeps the cache right, since each cached row was computed from
+  // the same input rows as are now at its position.
+  const int input_height = input_shape.Dims(1);
+  const int input_row_bytes = g_state.input_bytes / input_height;
+  int shift = input_height;
+  if (g_state.has_last_input) {
+    for (int i = 0; i < input_height; ++i) {
+      if (memcmp(input_data, g_state.last_input + (i * input_row_bytes),
+                 (input_height - i) * input_row_bytes) == 0) {
+        shift = i;
+        break;
+      }
+    }
+  }
+  g_state.window_position += shift;
+  memcpy(g_state.last_input, input_data, g_state.input_bytes);
+  g_state.has_last_input = true;
+  ++g_state.stats.invokes;
+
+  const int row_bytes = g_state.output_row_bytes;
+  const int filter_height = filter_shape.Dims(1);
+  int uncached_start = -1;
+  for (int row = 0; row <= output_height; ++row) {
+    int8_t* cached = nullptr;
+    bool is_cached = false;
+    if (row < output_height) {
+      const int band_start =
+          (row * conv_params.stride_height) - conv_params.padding_values.height;
+      if ((band_start >= 0) && (band_start + filter_height <= input_height)) {
+        const int64_t position = g_state.window_position + band_start;
+        const int slot = static_cast<int>(position % g_state.slot_count);
+        cached = g_state.rows + (slot * row_bytes);
+        is_cached = (g_state.row_positions[slot] == position);
+      }
+    }
+    if (!is_cached && (row < output_height)) {
+      if (uncached_start < 0) {
+        uncached_start = row;
+      }
+      continue;
+    }
+
+    // Compute the run of rows that ends here, and cache those that can be.
+    if (uncached_start >= 0) {
+      ComputeRows(conv_params, data, input_shape, input_data, filter_shape,
+                  filter_data, bias_shape, bias_data, output_shape,
+                  uncached_start, row,
+                  output_data + (uncached_start * row_bytes));
+      for (int i = uncached_start; i < row; ++i) {
+        const int band_start =
+            (i * conv_params.stride_height) - conv_params.padding_values.height;
+        if ((band_start >= 0) && (band_start + filter_height <= input_height)) {
+          const int64_t position = g_state.window_position + band_start;
+          const int slot = static_cast<int>(position % g_state.slot_count);
+          memcpy(g_state.rows + (slot * row_bytes),
+                 output_data + (i * row_bytes), row_bytes);
+          g_state.row_positions[slot] = position;
+        }
+      }
+      g_state.stats.rows_computed += row - uncached_start;
+      uncached_start = -1;
+    }
+    if (row == output_height) {
+      break;
+    }
+
+    memcpy(output_data + (row * row_bytes), cached, row_bytes);
+    ++g_state.stats.rows_reused;
+    if (g_state.checking) {
+      ComputeRows(conv_params, data, input_shape, input_data, filter_shape,
+                  filter_data, bias_shape, bias_data, output_shape, row,
+                  row + 1, g_state.check_row);
+      if (memcmp(g_state.check_row, cached, row_bytes) != 0) {
+        ++g_state.stats.rows_mismatched;
+      }
+    }
+  }
+  return kTfLiteOk;
+}
+
+}  // namespace
+
+TFLMRegistration Register_STREAMING_CONV_2D() {
+  return tflite::micro::RegisterOp(StreamingConvInit, StreamingConvPrepare,
+                                   StreamingConvEval);
+}
+
+void SetStreamingConvWorkspace(uint8_t* workspace, int size) {
+  g_state.workspace = workspace;
+  g_state.workspace_size = (workspace == nullptr) ? 0 : size;
+  g_state.owner = nullptr;
+  g_state.stats = {};
+}
+
+void SetStreamingConvChecking(bool checking) { g_state.checking = checking; }
+
+void GetStreamingConvStats(StreamingConvStats* stats) {
+  *stats = g_state.stats;
+}
@@ -0,0 +1,117 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_STREAMING_CONV_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_STREAMING_CONV_H_
+
+#include <cstdint>
+
+#include "micro_features_micro_model_settings.h"
+#include "tensorflow/lite/micro/micro_common.h"
+
+// A CONV_2D kernel for models that read a sliding window of feature slices,
+// like tiny_conv, which between two inferences usually sees only a slice or
+// two it hasn't seen before.
+//
+// Each output row of the convolution reads a band of filter-height input rows
+// (slices). A row whose band lies wholly inside the window is cached under the
+// band's position in the stream, and copied out again while the window slides
+// over it; only rows with new bands are computed. Rows whose band hangs over
+// either end of the window see the zero padding move as it slides, so they're
+// computed every time. The kernel works out how far the window slid by
+// comparing its input with the last one, so it never needs telling, and a
+// window that jumped (after a reset, or a skipped inference) just computes
+// every row. Computed rows come from TFLM's reference kernel, so the output is
+// bit-identical to a full CONV_2D; the layers after it run as before on the
+// filled-in output.
+//
+// Register it in place of the stock kernel and give it a workspace before
+// AllocateTensors():
+//
+//   micro_op_resolver.AddConv2D(Register_STREAMING_CONV_2D());
+//   SetStreamingConvWorkspace(workspace, sizeof(workspace));
+//
+// The workspace holds a copy of the last input and the cached rows, outside
+// the arena so tensor_arena_size.h stays right. Only the first convolution
+// prepared uses it; any other, or one without a big enough workspace, computes
+// every row like the reference kernel.
+//
+// At a one-slice slide, tiny_conv computes 6 of its 25 output rows: the ones
+// that read the new slice and the ones at either edge, where the padding
+// moves. That's about 58K of the convolution's 320K multiply-adds, or 74K of
+// the 336K in a whole inference with the fully connected layer, a 4.5x cut.
+//
+// It lives with the host tools, not the sketch, until it has been timed on the
+// device. The rows it computes run through TFLM's reference convolution,
+// which there is several times slower per multiply-add than the CMSIS-NN one
+// the stock kernel uses, and it adds its workspace to RAM and a compare of the
+// whole input to every Invoke(), so the cut in multiply-adds may not make the
+// inference any faster.
+
+// The workspace bytes to stream a convolution of `filter_height` rows over an
+// `input_height` row input, with `input_row_bytes` and `output_row_bytes` per
+// input and output row.
+constexpr int StreamingConvWorkspaceSize(int input_height, int input_row_bytes,
+                                         int filter_height,
+                                         int output_row_bytes) {
+  // A position per cached row, the last input, a cache slot for each band
+  // start a window can hold, and a row to check cached ones against.
+  return ((input_height - filter_height + 1) *
+          (static_cast<int>(sizeof(int64_t)) + output_row_bytes)) +
+         (input_height * input_row_bytes) + output_row_bytes;
+}
+
+// tiny_conv's convolution (see model_training/): 8 filters 10 slices tall,
+// moving 2 slices and 2 channels at a time, with SAME padding.
+constexpr int kTinyConvFilterHeight = 10;
+constexpr int kTinyConvFilterCount = 8;
+constexpr int kTinyConvStride = 2;
+
+// The workspace tiny_conv needs over a `Settings` spectrogram; 8840 bytes for
+// the default model.
+template <typename Settings>
+constexpr int TinyConvStreamingWorkspaceSize() {
+  return StreamingConvWorkspaceSize(
+      Settings::kFeatureSliceCount, Settings::kFeatureSliceSize,
+      kTinyConvFilterHeight,
+      ((Settings::kFeatureSliceSize + kTinyConvStride - 1) / kTinyConvStride) *
+          kTinyConvFilterCount);
+}
+
+// What the streaming kernel has done since it was given its workspace.
+struct StreamingConvStats {
+  uint32_t invokes;
+  // Output rows computed and copied from the cache, over all invokes.
+  uint32_t rows_computed;
+  uint32_t rows_reused;
+  // With checking on, reused rows that didn't match a fresh computation. Any
+  // at all is a bug.
+  uint32_t rows_mismatched;
+};
+
+// The int8 CONV_2D kernel described above.
+TFLMRegistration Register_STREAMING_CONV_2D();
+
+// Gives the kernel `size` bytes at `workspace`, 8-byte aligned, for the next
+// AllocateTensors(). Null turns streaming off. Resets the stats.
+void SetStreamingConvWorkspace(uint8_t* workspace, int size);
+
+// Also computes every reused row afresh and counts any that differ, for
+// checking the cache on a host; this costs more than streaming saves.
+void SetStreamingConvChecking(bool checking);
+
+void GetStreamingConvStats(StreamingConvStats* stats);
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_STREAMING_CONV_H_
@@ -0,0 +1,99 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "wav_reader.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+uint32_t ReadLe32(const uint8_t* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) |
+         (static_cast<uint32_t>(data[3]) << 24);
+}
+
+uint16_t ReadLe16(const uint8_t* data) { return data[0] | (data[1] << 8); }
+
+}  // namespace
+
+bool ReadWavFile(const char* path, std::vector<int16_t>* samples,
+                 int* sample_rate) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    fprintf(stderr, "Couldn't open %s\n", path);
+    return false;
+  }
+
+  uint8_t riff_header[12];
+  if ((fread(riff_header, 1, sizeof(riff_header), file) !=
+       sizeof(riff_header)) ||
+      (memcmp(riff_header, "RIFF", 4) != 0) ||
+      (memcmp(riff_header + 8, "WAVE", 4) != 0)) {
+    fprintf(stderr, "%s is not a RIFF/WAVE file\n", path);
+    fclose(file);
+    return false;
+  }
+
+  // Walk the chunks until we've seen both the format and the sample data. Any
+  // other chunks (LIST, fact, ...) are skipped.
+  uint16_t channels = 0;
+  uint16_t bits_per_sample = 0;
+  bool have_format = false;
+  uint8_t chunk_header[8];
+  while (fread(chunk_header, 1, sizeof(chunk_header), file) ==
+         sizeof(chunk_header)) {
+    const uint32_t chunk_size = ReadLe32(chunk_header + 4);
+    if (memcmp(chunk_header, "fmt ", 4) == 0) {
+      uint8_t format[16];
+      if ((chunk_size < sizeof(format)) ||
+          (fread(format, 1, sizeof(format), file) != sizeof(format))) {
+        break;
+      }
+      const uint16_t audio_format = ReadLe16(format);
+      channels = ReadLe16(format + 2);
+      *sample_rate = static_cast<int>(ReadLe32(format + 4));
+      bits_per_sample = ReadLe16(format + 14);
+      if ((audio_format != 1) || (bits_per_sample != 16) || (channels == 0)) {
+        fprintf(stderr, "%s must be 16-bit PCM, got format %d with %d bits\n",
+                path, audio_format, bits_per_sample);
+        fclose(file);
+        return false;
+      }
+      have_format = true;
+      fseek(file, (chunk_size - sizeof(format)) + (chunk_size & 1), SEEK_CUR);
+    } else if (memcmp(chunk_header, "data", 4) == 0) {
+      if (!have_format) {
+        break;
+      }
+      std::vector<int16_t> interleaved(chunk_size / sizeof(int16_t));
+      const size_t read =
+          fread(interleaved.data(), sizeof(int16_t), interleaved.size(), file);
+      fclose(file);
+      samples->clear();
+      samples->reserve(read / channels);
+      for (size_t i = 0; i + channels <= read; i += channels) {
+        samples->push_back(interleaved[i]);
+      }
+      return true;
+    } else {
+      fseek(file, chunk_size + (chunk_size & 1), SEEK_CUR);
+    }
+  }
+
+  fprintf(stderr, "%s has no usable fmt/data chunks\n", path);
+  fclose(file);
+  return false;
+}
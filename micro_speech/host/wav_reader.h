@@ -0,0 +1,30 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_WAV_READER_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_WAV_READER_H_
+
+#include <cstdint>
+#include <vector>
+
+// Reads a RIFF/WAVE file holding 16-bit PCM audio into `samples`. Only the
+// first channel of multi-channel files is kept. The file's sample rate is
+// returned in `sample_rate` so the caller can reject files that don't match
+// what the model was trained on. Returns false and prints the reason if the
+// file can't be read.
+bool ReadWavFile(const char* path, std::vector<int16_t>* samples,
+                 int* sample_rate);
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_HOST_WAV_READER_H_
@@ -0,0 +1,69 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "idle_meter.h"
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else  // defined(ARDUINO)
+#include <chrono>
+#endif  // defined(ARDUINO)
+
+void IdleMeter::Start() {
+  start_us_ = IdleMeterMicros();
+  idle_start_us_ = start_us_;
+  idle_us_ = 0;
+}
+
+void IdleMeter::BeginIdle() { idle_start_us_ = IdleMeterMicros(); }
+
+void IdleMeter::EndIdle() { idle_us_ += IdleMeterMicros() - idle_start_us_; }
+
+uint64_t IdleMeter::elapsed_us() const {
+  return IdleMeterMicros() - start_us_;
+}
+
+int IdleMeter::idle_permille() const {
+  const uint64_t elapsed = elapsed_us();
+  if (elapsed == 0) {
+    return 0;
+  }
+  return static_cast<int>((idle_us_ * 1000) / elapsed);
+}
+
+#if defined(ARDUINO)
+
+uint64_t IdleMeterMicros() {
+  // micros() wraps every 71 minutes, so carry each wrap into the top half.
+  // The main loop reads it far more often than that.
+  static uint32_t last_us = 0;
+  static uint64_t wraps_us = 0;
+  const uint32_t now_us = micros();
+  if (now_us < last_us) {
+    wraps_us += uint64_t{1} << 32;
+  }
+  last_us = now_us;
+  return wraps_us + now_us;
+}
+
+#else  // defined(ARDUINO)
+
+uint64_t IdleMeterMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+#endif  // defined(ARDUINO)
@@ -0,0 +1,54 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_IDLE_METER_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_IDLE_METER_H_
+
+#include <cstdint>
+
+// Counts how much of the time the main loop spends asleep waiting for the
+// next block of audio. That share is the pipeline's headroom: near 100% it
+// has plenty of time to spare, and near 0% it's only just keeping up with the
+// microphone (the capture ring's overrun counter says when it hasn't).
+//
+// It's cheap enough to leave on: two reads of a microsecond clock per wait.
+class IdleMeter {
+ public:
+  // Starts measuring from now, clearing the counts.
+  void Start();
+
+  // Bracket each wait.
+  void BeginIdle();
+  void EndIdle();
+
+  // Microseconds spent waiting, and since Start().
+  uint64_t idle_us() const { return idle_us_; }
+  uint64_t elapsed_us() const;
+
+  // idle_us() as a share of elapsed_us(), in tenths of a percent, so it can
+  // be printed without floating point.
+  int idle_permille() const;
+
+ private:
+  uint64_t start_us_ = 0;
+  uint64_t idle_start_us_ = 0;
+  uint64_t idle_us_ = 0;
+};
+
+// A free-running microsecond clock that doesn't wrap: micros() on the device,
+// std::chrono::steady_clock on the host.
+uint64_t IdleMeterMicros();
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_IDLE_METER_H_
@@ -0,0 +1,193 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "inference_scheduler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "tensorflow/lite/micro/micro_log.h"
+
+#if defined(ARDUINO)
+#include "Arduino.h"
+#endif  // defined(ARDUINO)
+
+InferenceScheduler::InferenceScheduler(const InferencePolicy& policy)
+    : policy_(kDefaultInferencePolicy) {
+  SetPolicy(policy);
+}
+
+TfLiteStatus InferenceScheduler::SetPolicy(const InferencePolicy& policy) {
+  // The cap on the interval also bounds the backoff's shift.
+  if ((policy.idle_interval_slices < 1) ||
+      (policy.max_interval_slices < policy.idle_interval_slices) ||
+      (policy.max_interval_slices > 255) || (policy.rising_margin < 0) ||
+      (policy.rising_margin > 255) || (policy.behind_slices < 1)) {
+    MicroPrintf("Bad inference policy %d,%d,%d,%d",
+                static_cast<int>(policy.idle_interval_slices),
+                static_cast<int>(policy.rising_margin),
+                static_cast<int>(policy.behind_slices),
+                static_cast<int>(policy.max_interval_slices));
+    return kTfLiteError;
+  }
+  policy_ = policy;
+  backoff_ = 0;
+  return kTfLiteOk;
+}
+
+int32_t InferenceScheduler::IdleInterval() const {
+  return std::min(policy_.idle_interval_slices << backoff_,
+                  policy_.max_interval_slices);
+}
+
+bool InferenceScheduler::ShouldInvoke(int new_slices) {
+  if (new_slices <= 0) {
+    return false;
+  }
+  stats_.slices += new_slices;
+  slices_since_inference_ += new_slices;
+  bool should_invoke;
+  if (is_paused_) {
+    is_paused_ = false;
+    should_invoke = true;
+  } else {
+    if (new_slices > policy_.behind_slices) {
+      ++stats_.behind_passes;
+      if (IdleInterval() < policy_.max_interval_slices) {
+        ++backoff_;
+      }
+    } else if (backoff_ > 0) {
+      --backoff_;
+    }
+    should_invoke = (slices_since_inference_ >= IdleInterval());
+    if (!should_invoke && is_rising_) {
+      ++stats_.rising_inferences;
+      should_invoke = true;
+    }
+  }
+  if (should_invoke) {
+    slices_since_inference_ = 0;
+    ++stats_.inferences;
+  }
+  return should_invoke;
+}
+
+void InferenceScheduler::RecordResult(uint8_t command_score,
+                                      uint8_t detection_threshold) {
+  is_rising_ = (policy_.rising_margin > 0) &&
+               (command_score > last_command_score_) &&
+               (command_score + policy_.rising_margin >= detection_threshold);
+  last_command_score_ = command_score;
+}
+
+void InferenceScheduler::Pause() {
+  is_paused_ = true;
+  is_rising_ = false;
+}
+
+void InferenceScheduler::GetStats(InferenceSchedulerStats* stats) const {
+  *stats = stats_;
+  stats->interval_slices = IdleInterval();
+}
+
+bool ParseInferencePolicy(const char* text, InferencePolicy* policy) {
+  if (strcmp(text, "every") == 0) {
+    *policy = kEverySliceInferencePolicy;
+    return true;
+  }
+  InferencePolicy parsed = kScheduledInferencePolicy;
+  int32_t* fields[] = {&parsed.idle_interval_slices, &parsed.rising_margin,
+                       &parsed.behind_slices, &parsed.max_interval_slices};
+  const char* next = text;
+  for (int32_t* field : fields) {
+    char* end = nullptr;
+    const long value = strtol(next, &end, 10);
+    if (end == next) {
+      return false;
+    }
+    *field = static_cast<int32_t>(value);
+    if (*end == '\0') {
+      // The interval cap keeps up with a longer idle interval.
+      parsed.max_interval_slices = std::max(parsed.max_interval_slices,
+                                            parsed.idle_interval_slices);
+      *policy = parsed;
+      return true;
+    }
+    if (*end != ',') {
+      return false;
+    }
+    next = end + 1;
+  }
+  return false;
+}
+
+void LogInferenceScheduler(const InferencePolicy& policy,
+                           const InferenceSchedulerStats& stats) {
+  // Permille, since MicroPrintf may not print floating point.
+  const int run_permille =
+      (stats.slices == 0)
+          ? 0
+          : static_cast<int>((stats.inferences * 1000ull) / stats.slices);
+  MicroPrintf(
+      "Inference policy %d,%d,%d,%d: %d of %d slices run (%d.%d%%), %d "
+      "rising, %d passes behind, interval %d",
+      static_cast<int>(policy.idle_interval_slices),
+      static_cast<int>(policy.rising_margin),
+      static_cast<int>(policy.behind_slices),
+      static_cast<int>(policy.max_interval_slices),
+      static_cast<int>(stats.inferences), static_cast<int>(stats.slices),
+      run_permille / 10, run_permille % 10,
+      static_cast<int>(stats.rising_inferences),
+      static_cast<int>(stats.behind_passes),
+      static_cast<int>(stats.interval_slices));
+}
+
+#if defined(ARDUINO)
+
+void InferenceSchedulerPoll(InferenceScheduler* scheduler) {
+  // Only peek, so any other serial traffic is left for TestOverSerial and the
+  // profiler.
+  if (Serial.available() <= 0) {
+    return;
+  }
+  const int request = Serial.peek();
+  if (request == kInferencePolicyRequest) {
+    // Wait for the whole request.
+    if (Serial.available() < 5) {
+      return;
+    }
+    Serial.read();
+    InferencePolicy policy;
+    policy.idle_interval_slices = Serial.read();
+    policy.rising_margin = Serial.read();
+    policy.behind_slices = Serial.read();
+    policy.max_interval_slices = Serial.read();
+    scheduler->SetPolicy(policy);
+  } else if (request == kInferenceStatsRequest) {
+    Serial.read();
+  } else {
+    return;
+  }
+  InferenceSchedulerStats stats;
+  scheduler->GetStats(&stats);
+  LogInferenceScheduler(scheduler->policy(), stats);
+}
+
+#else  // defined(ARDUINO)
+
+void InferenceSchedulerPoll(InferenceScheduler*) {}
+
+#endif  // defined(ARDUINO)
@@ -0,0 +1,135 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_INFERENCE_SCHEDULER_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_INFERENCE_SCHEDULER_H_
+
+#include <cstdint>
+
+#include "tensorflow/lite/c/common.h"
+
+// Decides which passes through loop() run the model. Features still have to
+// be computed for every slice, but the model needn't see every one: while no
+// command is building up, an inference every few slices is enough for the
+// recognizer's one-second average.
+//
+// The model runs every idle_interval_slices slices. Once the recognizer's
+// command score is within rising_margin of its detection threshold and went up
+// at the last inference, it runs at every slice until the score stops rising,
+// so a command is reported as soon as the average gets there. A pass that
+// makes more than behind_slices slices means the last one took longer than a
+// capture block, so the loop is behind real time. Each such pass doubles the
+// interval, up to max_interval_slices, and each pass on time halves it again.
+// A rising score still runs at every slice even then, since a word is over in
+// a few dozen slices and missing it costs more than falling a little further
+// behind.
+struct InferencePolicy {
+  int32_t idle_interval_slices;
+  // In command score units (0 to 255); 0 never switches to every slice.
+  int32_t rising_margin;
+  int32_t behind_slices;
+  int32_t max_interval_slices;
+};
+
+// Inference at every slice, as loop() did before it had a scheduler.
+constexpr InferencePolicy kEverySliceInferencePolicy = {1, 0, 255, 1};
+// The policy the sweep in micro_speech_evaluate is built around: every third
+// slice (60ms) while idle, every slice from 60 points below the threshold, and
+// backing off when passes make more than the two slices a 32ms capture block
+// can hold. Its accuracy and latency haven't been measured yet.
+constexpr InferencePolicy kScheduledInferencePolicy = {3, 60, 2, 12};
+// The sketch's policy. It stays at every slice until
+// `micro_speech_evaluate --schedule=sweep` has been run on the dataset and a
+// scheduled policy is picked from its results.
+constexpr InferencePolicy kDefaultInferencePolicy = kEverySliceInferencePolicy;
+
+// What a scheduler has decided since it was made.
+struct InferenceSchedulerStats {
+  // New slices seen, and inferences run on them.
+  uint32_t slices;
+  uint32_t inferences;
+  // Inferences run at every slice because the score was rising, which the
+  // idle interval would have skipped.
+  uint32_t rising_inferences;
+  // Passes that found the loop behind real time.
+  uint32_t behind_passes;
+  // The interval the next idle inference waits for, backoff included.
+  int32_t interval_slices;
+};
+
+class InferenceScheduler {
+ public:
+  explicit InferenceScheduler(
+      const InferencePolicy& policy = kDefaultInferencePolicy);
+
+  // Takes effect from the next pass. Returns an error, and keeps the old
+  // policy, if `policy` makes no sense.
+  TfLiteStatus SetPolicy(const InferencePolicy& policy);
+  const InferencePolicy& policy() const { return policy_; }
+
+  // Call on each pass through the loop that made `new_slices` slices, and
+  // run the model if it returns true.
+  bool ShouldInvoke(int new_slices);
+
+  // Call after each inference with the recognizer's command_score() and
+  // detection_threshold().
+  void RecordResult(uint8_t command_score, uint8_t detection_threshold);
+
+  // Call on passes the voice activity gate skips. The pass after a pause runs
+  // the model, and the slices it catches up on don't count as being behind.
+  void Pause();
+
+  void GetStats(InferenceSchedulerStats* stats) const;
+
+ private:
+  // The interval while idle, after backoff.
+  int32_t IdleInterval() const;
+
+  InferencePolicy policy_;
+  int slices_since_inference_ = 0;
+  // How many times the idle interval has been doubled.
+  int backoff_ = 0;
+  uint8_t last_command_score_ = 0;
+  bool is_rising_ = false;
+  bool is_paused_ = true;
+  InferenceSchedulerStats stats_ = {};
+};
+
+// Parses a policy written as up to four comma-separated numbers, in the order
+// of InferencePolicy's fields, with any left off taken from
+// kScheduledInferencePolicy, or "every" for kEverySliceInferencePolicy. For
+// command lines; returns false if `text` isn't one.
+bool ParseInferencePolicy(const char* text, InferencePolicy* policy);
+
+// Byte the host sends over serial to set the sketch's policy, followed by a
+// byte for each of InferencePolicy's fields, in order. The device answers with
+// the policy and its stats, as it does for kInferenceStatsRequest.
+constexpr uint8_t kInferencePolicyRequest = 0x11;
+constexpr uint8_t kInferenceStatsRequest = 0x12;
+
+// On the device, checks the serial port for the requests above and answers
+// them for `scheduler`.
+void InferenceSchedulerPoll(InferenceScheduler* scheduler);
+
+// Prints `policy` and `stats` on one line through MicroPrintf.
+void LogInferenceScheduler(const InferencePolicy& policy,
+                           const InferenceSchedulerStats& stats);
+
+// The sketch's scheduler: its stats, and setting its policy, on the host
+// before setup() or on the device at any time.
+void GetInferenceSchedulerStats(InferenceSchedulerStats* stats);
+TfLiteStatus SetSketchInferencePolicy(const InferencePolicy& policy);
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_INFERENCE_SCHEDULER_H_
@@ -18,7 +18,9 @@ limitations under the License.
 #include <cmath>
 #include <cstring>
 
+#include "feature_quantizer.h"
 #include "micro_features_micro_model_settings.h"
+#include "tensorflow/lite/experimental/microfrontend/lib/bits.h"
 #include "tensorflow/lite/experimental/microfrontend/lib/frontend.h"
 #include "tensorflow/lite/experimental/microfrontend/lib/frontend_util.h"
 #include "tensorflow/lite/micro/micro_log.h"
@@ -28,89 +30,259 @@ limitations under the License.
 
 namespace {
 
-FrontendState g_micro_features_state;
-bool g_is_first_time = true;
+// The context the free functions without one work on, used by the sketch.
+MicroFeaturesContext g_default_context;
+
+// Whether `context` was initialized for `Settings`, which the templated
+// functions size their work by.
+template <typename Settings>
+bool MatchesSettings(const MicroFeaturesContext* context) {
+  const FrontendState* state = &context->state;
+  if ((state->filterbank.num_channels != Settings::kFeatureSliceSize) ||
+      (static_cast<int>(state->window.size) !=
+       Settings::kFeatureSliceDurationSamples) ||
+      (static_cast<int>(state->window.step) !=
+       Settings::kFeatureSliceStrideSamples)) {
+    MicroPrintf("The features context wasn't initialized for the %s settings",
+                Settings::kName);
+    return false;
+  }
+  return true;
+}
+
+// WindowProcessSamples()'s windowing from the frontend's window.c, applied to
+// a whole window of `kWindowSize` samples wherever they are instead of to the
+// copy the frontend keeps. It must stay bit-identical to the original.
+template <int kWindowSize>
+void ApplyWindow(WindowState* window, const int16_t* input) {
+  const int16_t* coefficients = window->coefficients;
+  int16_t* output = window->output;
+  int16_t max_abs_output_value = 0;
+  for (int i = 0; i < kWindowSize; ++i) {
+    int16_t new_value = (static_cast<int32_t>(input[i]) * coefficients[i]) >>
+                        kFrontendWindowBits;
+    output[i] = new_value;
+    if (new_value < 0) {
+      new_value = -new_value;
+    }
+    if (new_value > max_abs_output_value) {
+      max_abs_output_value = new_value;
+    }
+  }
+  window->max_abs_output_value = max_abs_output_value;
+}
+
+// The stages of FrontendProcessSamples() after the window, except that the
+// last stage, the log scale, quantizes each value as soon as it's computed
+// instead of writing it to an array of uint16 for a second pass.
+template <typename Settings>
+void ProcessWindow(MicroFeaturesContext* context, int8_t* output) {
+  FrontendState* state = &context->state;
+  const int input_shift =
+      15 - MostSignificantBit32(state->window.max_abs_output_value);
+  FftCompute(&state->fft, state->window.output, input_shift);
+
+  // The energy reuses the FFT's output buffer, as the frontend does.
+  int32_t* energy = reinterpret_cast<int32_t*>(state->fft.output);
+  FilterbankConvertFftComplexToEnergy(&state->filterbank, state->fft.output,
+                                      energy);
+  FilterbankAccumulateChannels(&state->filterbank, energy);
+  uint32_t* scaled_filterbank = FilterbankSqrt(&state->filterbank, input_shift);
+
+  NoiseReductionApply(&state->noise_reduction, scaled_filterbank);
+  if (state->pcan_gain_control.enable_pcan) {
+    PcanGainControlApply(&state->pcan_gain_control, scaled_filterbank);
+  }
+
+  const int correction_bits =
+      MostSignificantBit32(state->fft.fft_size) - 1 - (kFilterbankBits / 2);
+  LogScaleAndQuantizeFeatures(&state->log_scale, scaled_filterbank,
+                              Settings::kFeatureSliceSize, correction_bits,
+                              output);
+}
 
 }  // namespace
 
-TfLiteStatus InitializeMicroFeatures() {
+MicroFeaturesContext* DefaultMicroFeaturesContext() {
+  return &g_default_context;
+}
+
+template <typename Settings>
+TfLiteStatus InitializeMicroFeatures(MicroFeaturesContext* context) {
   FrontendConfig config;
-  config.window.size_ms = kFeatureSliceDurationMs;
-  config.window.step_size_ms = kFeatureSliceStrideMs;
-  config.noise_reduction.smoothing_bits = 10;
-  config.filterbank.num_channels = kFeatureSliceSize;
-  config.filterbank.lower_band_limit = 125.0;
-  config.filterbank.upper_band_limit = 7500.0;
-  config.noise_reduction.smoothing_bits = 10;
-  config.noise_reduction.even_smoothing = 0.025;
-  config.noise_reduction.odd_smoothing = 0.06;
-  config.noise_reduction.min_signal_remaining = 0.05;
+  config.window.size_ms = Settings::kFeatureSliceDurationMs;
+  config.window.step_size_ms = Settings::kFeatureSliceStrideMs;
+  config.filterbank.num_channels = Settings::kFeatureSliceSize;
+  config.filterbank.lower_band_limit = Settings::kLowerBandLimitHz;
+  config.filterbank.upper_band_limit = Settings::kUpperBandLimitHz;
+  config.noise_reduction.smoothing_bits = Settings::kNoiseSmoothingBits;
+  config.noise_reduction.even_smoothing = Settings::kNoiseEvenSmoothing;
+  config.noise_reduction.odd_smoothing = Settings::kNoiseOddSmoothing;
+  config.noise_reduction.min_signal_remaining =
+      Settings::kNoiseMinSignalRemaining;
   config.pcan_gain_control.enable_pcan = 1;
-  config.pcan_gain_control.strength = 0.95;
-  config.pcan_gain_control.offset = 80.0;
-  config.pcan_gain_control.gain_bits = 21;
+  config.pcan_gain_control.strength = Settings::kPcanStrength;
+  config.pcan_gain_control.offset = Settings::kPcanOffset;
+  config.pcan_gain_control.gain_bits = Settings::kPcanGainBits;
   config.log_scale.enable_log = 1;
-  config.log_scale.scale_shift = 6;
-  if (!FrontendPopulateState(&config, &g_micro_features_state,
-                             kAudioSampleFrequency)) {
+  config.log_scale.scale_shift = Settings::kLogScaleShift;
+  // Release the tables from any earlier initialization before allocating new
+  // ones, so repeated setups don't leak.
+  FreeMicroFeatures(context);
+  if (!FrontendPopulateState(&config, &context->state,
+                             Settings::kAudioSampleFrequency)) {
     MicroPrintf("FrontendPopulateState() failed");
     return kTfLiteError;
   }
-  g_is_first_time = true;
+  context->is_state_populated = true;
   return kTfLiteOk;
 }
 
-// This is not exposed in any header, and is only used for testing, to ensure
-// that the state is correctly set up before generating results.
+TfLiteStatus InitializeMicroFeatures() {
+  return InitializeMicroFeatures(&g_default_context);
+}
+
+void FreeMicroFeatures(MicroFeaturesContext* context) {
+  if (context->is_state_populated) {
+    FrontendFreeStateContents(&context->state);
+    context->is_state_populated = false;
+  }
+}
+
+void GetMicroFeaturesNoiseEstimates(const MicroFeaturesContext* context,
+                                    uint32_t* estimates) {
+  for (int i = 0; i < context->state.filterbank.num_channels; ++i) {
+    estimates[i] = context->state.noise_reduction.estimate[i];
+  }
+}
+
+void SetMicroFeaturesNoiseEstimates(MicroFeaturesContext* context,
+                                    const uint32_t* estimate_presets) {
+  for (int i = 0; i < context->state.filterbank.num_channels; ++i) {
+    context->state.noise_reduction.estimate[i] = estimate_presets[i];
+  }
+}
+
 void SetMicroFeaturesNoiseEstimates(const uint32_t* estimate_presets) {
-  for (int i = 0; i < g_micro_features_state.filterbank.num_channels; ++i) {
-    g_micro_features_state.noise_reduction.estimate[i] = estimate_presets[i];
+  SetMicroFeaturesNoiseEstimates(&g_default_context, estimate_presets);
+}
+
+void ResetMicroFeaturesWindow(MicroFeaturesContext* context) {
+  context->state.window.input_used = 0;
+}
+
+template <typename Settings>
+TfLiteStatus StreamMicroFeatures(MicroFeaturesContext* context,
+                                 const int16_t* input, int input_size,
+                                 int8_t* output, size_t* num_samples_read,
+                                 bool* has_slice) {
+  if (!MatchesSettings<Settings>(context)) {
+    return kTfLiteError;
+  }
+  FrontendState* state = &context->state;
+  *has_slice = WindowProcessSamples(&state->window, input, input_size,
+                                    num_samples_read);
+  if (*has_slice) {
+    ProcessWindow<Settings>(context, output);
   }
+  return kTfLiteOk;
 }
 
-TfLiteStatus GenerateMicroFeatures(const int16_t* input, int input_size,
-                                   int output_size, int8_t* output,
-                                   size_t* num_samples_read) {
-  const int16_t* frontend_input;
-  if (g_is_first_time) {
-    frontend_input = input;
-    g_is_first_time = false;
-  } else {
-    frontend_input = input;
+template <typename Settings>
+TfLiteStatus StreamMicroFeatureSlices(MicroFeaturesContext* context,
+                                      const int16_t* input, int input_size,
+                                      int8_t* slices, int slot_count,
+                                      int* slot, int* slices_made) {
+  *slices_made = 0;
+  if (!MatchesSettings<Settings>(context)) {
+    return kTfLiteError;
   }
-  FrontendOutput frontend_output = FrontendProcessSamples(
-      &g_micro_features_state, frontend_input, input_size, num_samples_read);
-
-  for (size_t i = 0; i < frontend_output.size; ++i) {
-    // These scaling values are derived from those used in input_data.py in the
-    // training pipeline.
-    // The feature pipeline outputs 16-bit signed integers in roughly a 0 to 670
-    // range. In training, these are then arbitrarily divided by 25.6 to get
-    // float values in the rough range of 0.0 to 26.0. This scaling is performed
-    // for historical reasons, to match up with the output of other feature
-    // generators.
-    // The process is then further complicated when we quantize the model. This
-    // means we have to scale the 0.0 to 26.0 real values to the -128 to 127
-    // signed integer numbers.
-    // All this means that to get matching values from our integer feature
-    // output into the tensor input, we have to perform:
-    // input = (((feature / 25.6) / 26.0) * 256) - 128
-    // To simplify this and perform it in 32-bit integer math, we rearrange to:
-    // input = (feature * 256) / (25.6 * 26.0) - 128
-    constexpr int32_t value_scale = 256;
-    constexpr int32_t value_div = static_cast<int32_t>((25.6f * 26.0f) + 0.5f);
-    int32_t value =
-        ((frontend_output.values[i] * value_scale) + (value_div / 2)) /
-        value_div;
-    value -= 128;
-    if (value < -128) {
-      value = -128;
-    }
-    if (value > 127) {
-      value = 127;
+  WindowState* window = &context->state.window;
+  constexpr int slice_size = Settings::kFeatureSliceSize;
+  auto next_slice = [&]() {
+    *slot = (*slot + 1) % slot_count;
+    ++*slices_made;
+  };
+
+  // Until every sample the frontend holds for its next window is also in
+  // `input`, it has to be fed the usual way.
+  int taken = 0;
+  while ((taken < input_size) &&
+         (static_cast<int>(window->input_used) > taken)) {
+    size_t num_samples_read;
+    bool has_slice;
+    StreamMicroFeatures<Settings>(context, input + taken, input_size - taken,
+                                  slices + (*slot * slice_size),
+                                  &num_samples_read, &has_slice);
+    taken += static_cast<int>(num_samples_read);
+    if (has_slice) {
+      next_slice();
     }
-    output[i] = value;
+  }
+  if (static_cast<int>(window->input_used) > taken) {
+    return kTfLiteOk;
   }
 
+  // From here on every window lies entirely in `input`, so each is windowed
+  // straight from it, one after the other, instead of being copied in a
+  // stride at a time and shuffled down after.
+  constexpr int window_size = Settings::kFeatureSliceDurationSamples;
+  int window_start = taken - static_cast<int>(window->input_used);
+  while (window_start + window_size <= input_size) {
+    ApplyWindow<window_size>(window, input + window_start);
+    ProcessWindow<Settings>(context, slices + (*slot * slice_size));
+    next_slice();
+    window_start += Settings::kFeatureSliceStrideSamples;
+  }
+  // Leave the frontend holding the rest, as if it had been fed them.
+  window->input_used = input_size - window_start;
+  memcpy(window->input, input + window_start,
+         window->input_used * sizeof(*window->input));
   return kTfLiteOk;
 }
+
+template <typename Settings>
+TfLiteStatus GenerateMicroFeatures(MicroFeaturesContext* context,
+                                   const int16_t* input, int input_size,
+                                   int output_size, int8_t* output,
+                                   size_t* num_samples_read) {
+  if (output_size != Settings::kFeatureSliceSize) {
+    MicroPrintf("Feature output is %d values, expected %d for the %s settings",
+                output_size, Settings::kFeatureSliceSize, Settings::kName);
+    return kTfLiteError;
+  }
+  bool has_slice;
+  return StreamMicroFeatures<Settings>(context, input, input_size, output,
+                                       num_samples_read, &has_slice);
+}
+
+TfLiteStatus GenerateMicroFeatures(const int16_t* input, int input_size,
+                                   int output_size, int8_t* output,
+                                   size_t* num_samples_read) {
+  return GenerateMicroFeatures(&g_default_context, input, input_size,
+                               output_size, output, num_samples_read);
+}
+
+// The configurations the templates above are built for.
+template TfLiteStatus InitializeMicroFeatures<DefaultModelSettings>(
+    MicroFeaturesContext* context);
+template TfLiteStatus InitializeMicroFeatures<LowPowerModelSettings>(
+    MicroFeaturesContext* context);
+template TfLiteStatus StreamMicroFeatures<DefaultModelSettings>(
+    MicroFeaturesContext* context, const int16_t* input, int input_size,
+    int8_t* output, size_t* num_samples_read, bool* has_slice);
+template TfLiteStatus StreamMicroFeatures<LowPowerModelSettings>(
+    MicroFeaturesContext* context, const int16_t* input, int input_size,
+    int8_t* output, size_t* num_samples_read, bool* has_slice);
+template TfLiteStatus StreamMicroFeatureSlices<DefaultModelSettings>(
+    MicroFeaturesContext* context, const int16_t* input, int input_size,
+    int8_t* slices, int slot_count, int* slot, int* slices_made);
+template TfLiteStatus StreamMicroFeatureSlices<LowPowerModelSettings>(
+    MicroFeaturesContext* context, const int16_t* input, int input_size,
+    int8_t* slices, int slot_count, int* slot, int* slices_made);
+template TfLiteStatus GenerateMicroFeatures<DefaultModelSettings>(
+    MicroFeaturesContext* context, const int16_t* input, int input_size,
+    int output_size, int8_t* output, size_t* num_samples_read);
+template TfLiteStatus GenerateMicroFeatures<LowPowerModelSettings>(
+    MicroFeaturesContext* context, const int16_t* input, int input_size,
+    int output_size, int8_t* output, size_t* num_samples_read);
@@ -16,13 +16,86 @@ limitations under the License.
 #ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_MICRO_FEATURES_MICRO_FEATURES_GENERATOR_H_
 #define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_MICRO_FEATURES_MICRO_FEATURES_GENERATOR_H_
 
+#include "micro_features_micro_model_settings.h"
 #include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/experimental/microfrontend/lib/frontend.h"
 
-// Sets up any resources needed for the feature generation pipeline.
+// Everything the feature pipeline keeps between calls for one audio stream:
+// the frontend's tables plus its window, noise estimate and gain state. Give
+// every stream its own context and they can be processed independently, even
+// on different threads. The functions that don't take a context all share one
+// default context, which is what the sketch uses.
+//
+// The functions templated on `Settings` set up and run the frontend for that
+// pipeline configuration (see ModelSettings), with its slice and window sizes
+// fixed at compile time. A context must be used with the settings it was
+// initialized for; the others return an error. They're built for
+// DefaultModelSettings and LowPowerModelSettings.
+struct MicroFeaturesContext {
+  FrontendState state = {};
+  bool is_state_populated = false;
+};
+
+// Returns the context shared by the functions that don't take one.
+MicroFeaturesContext* DefaultMicroFeaturesContext();
+
+// Sets up any resources needed for the feature generation pipeline, releasing
+// those from any earlier call first.
+template <typename Settings = DefaultModelSettings>
+TfLiteStatus InitializeMicroFeatures(MicroFeaturesContext* context);
 TfLiteStatus InitializeMicroFeatures();
 
+// Releases the resources allocated by InitializeMicroFeatures().
+void FreeMicroFeatures(MicroFeaturesContext* context);
+
+// Pushes the next `input_size` samples of a stream into the frontend, which
+// keeps the overlap between one window and the next itself. It takes samples
+// until it has a whole window, sets `*num_samples_read` to how many that was,
+// and if it completed one, computes that window's slice of features into
+// `output` and sets `*has_slice`. Call it again with the rest of the input.
+template <typename Settings = DefaultModelSettings>
+TfLiteStatus StreamMicroFeatures(MicroFeaturesContext* context,
+                                 const int16_t* input, int input_size,
+                                 int8_t* output, size_t* num_samples_read,
+                                 bool* has_slice);
+
+// Pushes `input_size` contiguous samples of a stream into the frontend, like
+// calling StreamMicroFeatures() until it has taken them all, and writes the
+// slices it makes one after another into a ring of `slot_count` slices at
+// `slices`, starting at slot `*slot`, which is left at the slot after the
+// last one written. `*slices_made` is set to how many there were. Catching up
+// on several slices at once, each window is processed straight from `input`,
+// back to back, without being copied into the frontend first.
+template <typename Settings = DefaultModelSettings>
+TfLiteStatus StreamMicroFeatureSlices(MicroFeaturesContext* context,
+                                      const int16_t* input, int input_size,
+                                      int8_t* slices, int slot_count,
+                                      int* slot, int* slices_made);
+
+// Drops the samples the frontend is holding for its next window, so the next
+// ones pushed start a new one. The noise and gain estimates are kept.
+void ResetMicroFeaturesWindow(MicroFeaturesContext* context);
+
+// Reads or presets the frontend's per-channel noise estimates, one per
+// channel, which its noise reduction and PCAN gain control both adapt from.
+// They're everything the frontend learns from the audio, so copying them out
+// of one context and into a freshly initialized one carries it over. The
+// context must have been initialized.
+void GetMicroFeaturesNoiseEstimates(const MicroFeaturesContext* context,
+                                    uint32_t* estimates);
+void SetMicroFeaturesNoiseEstimates(MicroFeaturesContext* context,
+                                    const uint32_t* estimate_presets);
+void SetMicroFeaturesNoiseEstimates(const uint32_t* estimate_presets);
+
 // Converts audio sample data into a more compact form that's appropriate for
-// feeding into a neural network.
+// feeding into a neural network. The samples go through StreamMicroFeatures(),
+// so the window they fill starts with whatever the frontend kept from the
+// previous call.
+template <typename Settings = DefaultModelSettings>
+TfLiteStatus GenerateMicroFeatures(MicroFeaturesContext* context,
+                                   const int16_t* input, int input_size,
+                                   int output_size, int8_t* output,
+                                   size_t* num_samples_read);
 TfLiteStatus GenerateMicroFeatures(const int16_t* input, int input_size,
                                    int output_size, int8_t* output,
                                    size_t* num_samples_read);
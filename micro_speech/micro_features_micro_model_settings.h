@@ -19,20 +19,6 @@ limitations under the License.
 // Keeping these as constant expressions allow us to allocate fixed-sized arrays
 // on the stack for our working memory.
 
-// The size of the input time series data we pass to the FFT to produce the
-// frequency information. This has to be a power of two, and since we're dealing
-// with 30ms of 16KHz inputs, which means 480 samples, this is the next value.
-constexpr int kMaxAudioSampleSize = 512;
-constexpr int kAudioSampleFrequency = 16000;
-
-// The following values are derived from values used during model training.
-// If you change the way you preprocess the input, update all these constants.
-constexpr int kFeatureSliceSize = 40;
-constexpr int kFeatureSliceCount = 49;
-constexpr int kFeatureElementCount = (kFeatureSliceSize * kFeatureSliceCount);
-constexpr int kFeatureSliceStrideMs = 20;
-constexpr int kFeatureSliceDurationMs = 30;
-
 // Variables for the model's output categories.
 constexpr int kSilenceIndex = 0;
 constexpr int kUnknownIndex = 1;
@@ -40,4 +26,97 @@ constexpr int kUnknownIndex = 1;
 constexpr int kCategoryCount = 4;
 extern const char* kCategoryLabels[kCategoryCount];
 
+// The values that define one configuration of the pipeline: the audio it
+// takes, the spectrogram the model is trained on and the frontend that makes
+// it. These are derived from values used during model training. If you change
+// the way you preprocess the input, update them.
+//
+// FeatureProvider, the feature generator, the voice activity detector,
+// PreviousResultsQueue and RecognizeCommands are templates over a
+// ModelSettings<> of one of these, so each configuration gets its own buffers
+// sized and loops bounded at compile time, and several can be built from the
+// same source.
+
+// The model the sketch ships with: 16KHz audio, 40 channels from 125Hz to
+// 7.5KHz, a 30ms window every 20ms, and a second of slices per inference.
+struct Speech16kHz40ChannelConfig {
+  static constexpr const char* kName = "16khz_40ch";
+  static constexpr int kAudioSampleFrequency = 16000;
+  static constexpr int kFeatureSliceSize = 40;
+  static constexpr int kFeatureSliceCount = 49;
+  static constexpr int kFeatureSliceStrideMs = 20;
+  static constexpr int kFeatureSliceDurationMs = 30;
+  static constexpr int kCategoryCount = ::kCategoryCount;
+  static constexpr float kLowerBandLimitHz = 125.0f;
+  static constexpr float kUpperBandLimitHz = 7500.0f;
+};
+
+// A lower-power variant for the same commands: 8KHz audio, so half the
+// samples and a 256-point FFT, and 20 channels up to 3.8KHz, which halves the
+// filterbank and the spectrogram. It needs a model trained on features made
+// the same way, and audio captured or decimated to 8KHz.
+struct Speech8kHz20ChannelConfig {
+  static constexpr const char* kName = "8khz_20ch";
+  static constexpr int kAudioSampleFrequency = 8000;
+  static constexpr int kFeatureSliceSize = 20;
+  static constexpr int kFeatureSliceCount = 49;
+  static constexpr int kFeatureSliceStrideMs = 20;
+  static constexpr int kFeatureSliceDurationMs = 30;
+  static constexpr int kCategoryCount = ::kCategoryCount;
+  static constexpr float kLowerBandLimitHz = 125.0f;
+  static constexpr float kUpperBandLimitHz = 3800.0f;
+};
+
+// A configuration's values plus the ones that follow from them.
+template <typename Config>
+struct ModelSettings : Config {
+  static constexpr int kAudioSamplesPerMs =
+      Config::kAudioSampleFrequency / 1000;
+  static constexpr int kFeatureElementCount =
+      Config::kFeatureSliceSize * Config::kFeatureSliceCount;
+  // The pipeline's clock counts samples, so slices are scheduled in samples.
+  static constexpr int kFeatureSliceStrideSamples =
+      Config::kFeatureSliceStrideMs * kAudioSamplesPerMs;
+  static constexpr int kFeatureSliceDurationSamples =
+      Config::kFeatureSliceDurationMs * kAudioSamplesPerMs;
+  // The frontend's noise reduction, PCAN gain control and log scale are the
+  // same for every configuration.
+  static constexpr int kNoiseSmoothingBits = 10;
+  static constexpr float kNoiseEvenSmoothing = 0.025f;
+  static constexpr float kNoiseOddSmoothing = 0.06f;
+  static constexpr float kNoiseMinSignalRemaining = 0.05f;
+  static constexpr float kPcanStrength = 0.95f;
+  static constexpr float kPcanOffset = 80.0f;
+  static constexpr int kPcanGainBits = 21;
+  static constexpr int kLogScaleShift = 6;
+  static_assert(Config::kCategoryCount <= ::kCategoryCount,
+                "Every configuration's labels come from kCategoryLabels");
+};
+
+using DefaultModelSettings = ModelSettings<Speech16kHz40ChannelConfig>;
+using LowPowerModelSettings = ModelSettings<Speech8kHz20ChannelConfig>;
+
+// The size of the input time series data we pass to the FFT to produce the
+// frequency information. This has to be a power of two, and since we're dealing
+// with 30ms of 16KHz inputs, which means 480 samples, this is the next value.
+constexpr int kMaxAudioSampleSize = 512;
+
+// The default configuration's values, which the sketch and its audio sources
+// use.
+constexpr int kAudioSampleFrequency =
+    DefaultModelSettings::kAudioSampleFrequency;
+constexpr int kAudioSamplesPerMs = DefaultModelSettings::kAudioSamplesPerMs;
+constexpr int kFeatureSliceSize = DefaultModelSettings::kFeatureSliceSize;
+constexpr int kFeatureSliceCount = DefaultModelSettings::kFeatureSliceCount;
+constexpr int kFeatureElementCount =
+    DefaultModelSettings::kFeatureElementCount;
+constexpr int kFeatureSliceStrideMs =
+    DefaultModelSettings::kFeatureSliceStrideMs;
+constexpr int kFeatureSliceDurationMs =
+    DefaultModelSettings::kFeatureSliceDurationMs;
+constexpr int kFeatureSliceStrideSamples =
+    DefaultModelSettings::kFeatureSliceStrideSamples;
+constexpr int kFeatureSliceDurationSamples =
+    DefaultModelSettings::kFeatureSliceDurationSamples;
+
 #endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_MICRO_FEATURES_MICRO_MODEL_SETTINGS_H_
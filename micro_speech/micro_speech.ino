@@ -15,39 +15,94 @@ limitations under the License.
 
 #include <TensorFlowLite.h>
 
-#include "audio_provider.h"
 #include "command_responder.h"
 #include "feature_provider.h"
+#include "inference_scheduler.h"
 #include "main_functions.h"
 #include "micro_features_micro_model_settings.h"
 #include "micro_features_model.h"
+#include "pipeline_snapshot.h"
 #include "recognize_commands.h"
+#include "sketch_audio_source.h"
+#include "snapshot_store.h"
+#include "stage_profiler.h"
+#include "tensor_arena_size.h"
 #include "tensorflow/lite/micro/micro_interpreter.h"
 #include "tensorflow/lite/micro/micro_log.h"
 #include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
 #include "tensorflow/lite/micro/system_setup.h"
 #include "tensorflow/lite/schema/schema_generated.h"
-
-#undef PROFILE_MICRO_SPEECH
+#include "voice_activity.h"
 
 // Globals, used for compatibility with Arduino-style sketches.
 namespace {
 const tflite::Model* model = nullptr;
 tflite::MicroInterpreter* interpreter = nullptr;
 TfLiteTensor* model_input = nullptr;
-FeatureProvider* feature_provider = nullptr;
-RecognizeCommands* recognizer = nullptr;
-int32_t previous_time = 0;
+// The microphone, or whichever source sketch_audio_source.h picks.
+// NOLINTNEXTLINE(runtime-global-variables)
+SketchAudioSource audio_source;
+FeatureProvider<SketchAudioSource>* feature_provider = nullptr;
+RecognizeCommands<>* recognizer = nullptr;
+VoiceActivityGate<SketchAudioSource>* voice_activity_gate = nullptr;
+// Picks the passes with new slices that run the model.
+// NOLINTNEXTLINE(runtime-global-variables)
+InferenceScheduler inference_scheduler;
+// Where the next feature slice starts, on the audio sample clock.
+int64_t previous_time = 0;
+// The sample count the last pass through loop() started from. The next pass
+// sleeps until there's more.
+int64_t latest_sample_count = 0;
+
+// The pipeline's state is saved this often, on the audio clock, into the
+// snapshot store, which setup() restores it from.
+constexpr int64_t kSnapshotIntervalSamples = 1000 * kAudioSamplesPerMs;
+PipelineSnapshot<>* snapshot = nullptr;
+int64_t next_snapshot_time = 0;
+bool is_snapshot_restored = false;
 
 // Create an area of memory to use for input, output, and intermediate arrays.
-// The size of this will depend on the model you're using, and may need to be
-// determined by experimentation.
-constexpr int kTensorArenaSize = 10 * 1024;
-uint8_t tensor_arena[kTensorArenaSize];
+// Its size is measured from the model by host/arena_report and written to
+// tensor_arena_size.h; the build fails if that grows past our RAM budget.
+constexpr int kTensorArenaBudget = 10 * 1024;
+static_assert(kTensorArenaSize <= kTensorArenaBudget,
+              "g_model needs a larger tensor arena than kTensorArenaBudget");
+alignas(16) uint8_t tensor_arena[kTensorArenaSize];
 int8_t feature_buffer[kFeatureElementCount];
 int8_t* model_input_buffer = nullptr;
 }  // namespace
 
+SketchAudioSource* GetSketchAudioSource() { return &audio_source; }
+
+bool SketchSnapshotRestored() { return is_snapshot_restored; }
+
+void SaveSketchSnapshot() {
+  if ((snapshot == nullptr) || (feature_provider == nullptr) ||
+      (recognizer == nullptr)) {
+    return;
+  }
+  TakePipelineSnapshot(*feature_provider, *recognizer, latest_sample_count,
+                       snapshot);
+  SaveSnapshotRecord();
+}
+
+void GetVoiceActivityStats(uint32_t* passes_run, uint32_t* passes_skipped) {
+  *passes_run = (voice_activity_gate != nullptr)
+                    ? voice_activity_gate->passes_run()
+                    : 0;
+  *passes_skipped = (voice_activity_gate != nullptr)
+                        ? voice_activity_gate->passes_skipped()
+                        : 0;
+}
+
+void GetInferenceSchedulerStats(InferenceSchedulerStats* stats) {
+  inference_scheduler.GetStats(stats);
+}
+
+TfLiteStatus SetSketchInferencePolicy(const InferencePolicy& policy) {
+  return inference_scheduler.SetPolicy(policy);
+}
+
 // The name of this function is important for Arduino compatibility.
 void setup() {
   tflite::InitializeTarget();
@@ -109,19 +164,41 @@ void setup() {
   model_input_buffer = model_input->data.int8;
 
   // Prepare to access the audio spectrograms from a microphone or other source
-  // that will provide the inputs to the neural network.
+  // that will provide the inputs to the neural network. The audio is pushed
+  // into the frontend as it arrives, each sample once.
   // NOLINTNEXTLINE(runtime-global-variables)
-  static FeatureProvider static_feature_provider(kFeatureElementCount,
-                                                 feature_buffer);
+  static FeatureProvider<SketchAudioSource> static_feature_provider(
+      &audio_source, kFeatureElementCount, feature_buffer, nullptr,
+      kFeatureFeedStream);
   feature_provider = &static_feature_provider;
 
-  static RecognizeCommands static_recognizer;
+  static RecognizeCommands<> static_recognizer;
   recognizer = &static_recognizer;
 
+  // Skips the features and the model while nobody is talking.
+  // NOLINTNEXTLINE(runtime-global-variables)
+  static VoiceActivityGate<SketchAudioSource> static_voice_activity_gate(
+      &audio_source);
+  voice_activity_gate = &static_voice_activity_gate;
+
   previous_time = 0;
+  latest_sample_count = 0;
+
+  // Carry on with the noise estimates, spectrogram and recognizer history the
+  // last run left, if it saved any, instead of from silence.
+  snapshot =
+      static_cast<PipelineSnapshot<>*>(SnapshotRecord(sizeof(*snapshot)));
+  next_snapshot_time = kSnapshotIntervalSamples;
+  is_snapshot_restored =
+      (snapshot != nullptr) && IsValidPipelineSnapshot(*snapshot) &&
+      (RestorePipelineSnapshot(*snapshot, latest_sample_count,
+                               feature_provider, recognizer) == kTfLiteOk);
+  if (is_snapshot_restored) {
+    MicroPrintf("Restored the pipeline from its snapshot");
+  }
 
   // start the audio
-  TfLiteStatus init_status = InitAudioRecording();
+  TfLiteStatus init_status = audio_source.Init();
   if (init_status != kTfLiteOk) {
     MicroPrintf("Unable to initialize audio");
     return;
@@ -132,16 +209,40 @@ void setup() {
 
 // The name of this function is important for Arduino compatibility.
 void loop() {
-#ifdef PROFILE_MICRO_SPEECH
-  const uint32_t prof_start = millis();
-  static uint32_t prof_count = 0;
-  static uint32_t prof_sum = 0;
-  static uint32_t prof_min = std::numeric_limits<uint32_t>::max();
-  static uint32_t prof_max = 0;
-#endif  // PROFILE_MICRO_SPEECH
-
-  // Fetch the spectrogram for the current time.
-  const int32_t current_time = LatestAudioTimestamp();
+  // Answer any request for the per-stage latency histograms, then time each
+  // stage of this pass. See stage_profiler.h to enable this on the device.
+  ProfilerPoll();
+  ProfilerBeginLoop();
+  // Answer any request to change or report the inference policy.
+  InferenceSchedulerPoll(&inference_scheduler);
+
+  // Sleep until the capture has delivered a block this loop hasn't seen,
+  // instead of spinning. The share of time spent here is the pipeline's
+  // headroom, see audio_source.idle_meter(), which times it by a clock that
+  // keeps running in sleep, so the profiler takes its time from there.
+  const uint64_t idle_before_us = audio_source.idle_meter().idle_us();
+  audio_source.WaitForSamples(latest_sample_count);
+  ProfilerMarkMicros(kStageIdle,
+                     audio_source.idle_meter().idle_us() - idle_before_us);
+
+  // Fetch the spectrogram for the current time. Time is counted in audio
+  // samples, so it stays exact however long the sketch runs.
+  const int64_t current_time = audio_source.LatestSampleCount();
+  latest_sample_count = current_time;
+  ProfilerMark(kStageTimestamp);
+  // While it's quiet, don't compute features or run the model at all. The
+  // gate keeps the most recent audio waiting as pre-roll for when speech
+  // starts.
+  const bool is_voice_active =
+      voice_activity_gate->Update(current_time, &previous_time);
+  ProfilerMark(kStageVoiceActivity);
+  if (!is_voice_active) {
+    inference_scheduler.Pause();
+    return;
+  }
+  if (voice_activity_gate->window_is_stale()) {
+    feature_provider->ClearFeatureData();
+  }
   int how_many_new_slices = 0;
   TfLiteStatus feature_status = feature_provider->PopulateFeatureData(
       previous_time, current_time, &how_many_new_slices);
@@ -149,24 +250,31 @@ void loop() {
     MicroPrintf("Feature generation failed");
     return;
   }
-  previous_time += how_many_new_slices * kFeatureSliceStrideMs;
+  ProfilerMark(kStageFeatures);
+  previous_time += how_many_new_slices * kFeatureSliceStrideSamples;
   // If no new audio samples have been received since last time, don't bother
   // running the network model.
   if (how_many_new_slices == 0) {
     return;
   }
-
-  // Copy feature buffer to input tensor
-  for (int i = 0; i < kFeatureElementCount; i++) {
-    model_input_buffer[i] = feature_buffer[i];
+  // Every slice goes into the spectrogram, but the model only runs when the
+  // scheduler says so: every few slices, unless a command is building up or
+  // the loop is behind (see inference_scheduler.h).
+  if (!inference_scheduler.ShouldInvoke(how_many_new_slices)) {
+    return;
   }
 
+  // Copy the spectrogram to the input tensor, oldest slice first
+  feature_provider->CopyFeatureData(model_input_buffer);
+  ProfilerMark(kStageCopy);
+
   // Run the model on the spectrogram input and make sure it succeeds.
   TfLiteStatus invoke_status = interpreter->Invoke();
   if (invoke_status != kTfLiteOk) {
     MicroPrintf("Invoke failed");
     return;
   }
+  ProfilerMark(kStageInvoke);
 
   // Obtain a pointer to the output tensor
   TfLiteTensor* output = interpreter->output(0);
@@ -180,26 +288,18 @@ void loop() {
     MicroPrintf("RecognizeCommands::ProcessLatestResults() failed");
     return;
   }
+  inference_scheduler.RecordResult(recognizer->command_score(),
+                                   recognizer->detection_threshold());
+  ProfilerMark(kStageRecognize);
   // Do something based on the recognized command. The default implementation
   // just prints to the error console, but you should replace this with your
   // own function for a real application.
-  RespondToCommand(current_time, found_command, score, is_new_command);
-
-#ifdef PROFILE_MICRO_SPEECH
-  const uint32_t prof_end = millis();
-  if (++prof_count > 10) {
-    uint32_t elapsed = prof_end - prof_start;
-    prof_sum += elapsed;
-    if (elapsed < prof_min) {
-      prof_min = elapsed;
-    }
-    if (elapsed > prof_max) {
-      prof_max = elapsed;
-    }
-    if (prof_count % 300 == 0) {
-      MicroPrintf("## time: min %dms  max %dms  avg %dms", prof_min, prof_max,
-                  prof_sum / prof_count);
-    }
-  }
-#endif  // PROFILE_MICRO_SPEECH
+  RespondToCommand(current_time / kAudioSamplesPerMs, found_command, score,
+                   is_new_command);
+  ProfilerMark(kStageRespond);
+
+  if (current_time >= next_snapshot_time) {
+    SaveSketchSnapshot();
+    next_snapshot_time = current_time + kSnapshotIntervalSamples;
+  }
 }
@@ -0,0 +1,88 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Only the source picked by sketch_audio_source.h is built, since each one
+// claims its peripheral's interrupt.
+#include "sketch_audio_source.h"
+
+#if defined(ARDUINO) && (!defined(ARDUINO_ARDUINO_NANO33BLE) || \
+    !defined(SKETCH_AUDIO_SOURCE_PDM))
+#define ARDUINO_EXCLUDE_CODE
+#endif  // defined(ARDUINO) && (...)
+
+#ifndef ARDUINO_EXCLUDE_CODE
+
+#include "pdm_audio_source.h"
+
+#include <mbed.h>
+
+#include "PDM.h"
+#include "micro_features_micro_model_settings.h"
+#include "tensorflow/lite/micro/micro_log.h"
+
+// PDM gain: -20db (min) + 6.5db (13) + 3.2db (rounded to 2) = -10.3db
+#ifndef PDM_GAIN
+#define PDM_GAIN 13
+#endif
+
+// The library delivers DEFAULT_PDM_BUFFER_SIZE bytes at a time.
+static_assert(kAudioCaptureBufferSize % (DEFAULT_PDM_BUFFER_SIZE / 2) == 0,
+              "The capture buffer must hold a whole number of PDM buffers");
+
+namespace {
+// The instance the receive callback feeds.
+PdmAudioSource* g_source = nullptr;
+// Staging for one PDM buffer, since the library only copies out to memory.
+int16_t g_pdm_buffer[DEFAULT_PDM_BUFFER_SIZE / 2];
+
+void CaptureSamples() { g_source->OnReceive(); }
+}  // namespace
+
+PdmAudioSource::PdmAudioSource() { g_source = this; }
+
+void PdmAudioSource::OnReceive() {
+  int bytes_available = PDM.available();
+  if (bytes_available > static_cast<int>(sizeof(g_pdm_buffer))) {
+    bytes_available = sizeof(g_pdm_buffer);
+  }
+  const int bytes_read = PDM.read(g_pdm_buffer, bytes_available);
+  ring().Write(g_pdm_buffer, bytes_read / 2);
+  // Wake the main thread if it's asleep in WaitForCapture().
+  __SEV();
+}
+
+TfLiteStatus PdmAudioSource::StartCapture() {
+  // Hook up the callback that will be called with each sample
+  PDM.onReceive(CaptureSamples);
+  // Start listening for audio: MONO @ 16KHz
+  if (!PDM.begin(1, kAudioSampleFrequency)) {
+    MicroPrintf("Failed to start PDM capture");
+    return kTfLiteError;
+  }
+  PDM.setGain(PDM_GAIN);
+  // Block until we have our first audio sample
+  WaitForCapture(0);
+  return kTfLiteOk;
+}
+
+void PdmAudioSource::WaitForCapture(int64_t sample_count) {
+  // The receive callback signals an event after each buffer, which WFE can't
+  // miss even if it arrives just before the sleep.
+  while (static_cast<int64_t>(ring().write_position()) <= sample_count) {
+    __WFE();
+  }
+}
+
+#endif  // ARDUINO_EXCLUDE_CODE
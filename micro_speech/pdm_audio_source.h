@@ -0,0 +1,40 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_PDM_AUDIO_SOURCE_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_PDM_AUDIO_SOURCE_H_
+
+#include <cstdint>
+
+#include "audio_source.h"
+
+// Captures a PDM microphone, such as the one on the Arduino Nano 33 BLE Sense,
+// through the Arduino PDM library. The library's receive callback runs in
+// interrupt context each time its DMA buffer fills and copies the samples into
+// the capture ring. Only one instance can exist, since it owns the PDM
+// peripheral.
+class PdmAudioSource : public AudioSource<PdmAudioSource> {
+ public:
+  PdmAudioSource();
+
+  // AudioSource hooks.
+  TfLiteStatus StartCapture();
+  void WaitForCapture(int64_t sample_count);
+
+  // Called by the PDM library when new samples are ready.
+  void OnReceive();
+};
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_PDM_AUDIO_SOURCE_H_
@@ -0,0 +1,136 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_PIPELINE_SNAPSHOT_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_PIPELINE_SNAPSHOT_H_
+
+#include <cstdint>
+
+#include "feature_provider.h"
+#include "micro_features_micro_model_settings.h"
+#include "recognize_commands.h"
+#include "tensorflow/lite/c/common.h"
+
+// Everything the pipeline learns from the audio, in one record that can be
+// kept across a reset: the frontend's noise estimates, the spectrogram the
+// model reads, and the recognizer's averaging window and last command. From a
+// cold start the noise estimates take a second or more to converge, the
+// spectrogram starts out blank, and the recognizer won't answer until it has
+// `minimum_count` results, so restoring a recent snapshot instead makes the
+// first second after boot or wake as reliable as any other. See
+// snapshot_store.h for where the sketch keeps it.
+
+// Identifies the record: what wrote it, for which configuration, and whether
+// it arrived intact.
+struct PipelineSnapshotHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t feature_slice_size;
+  uint16_t feature_slice_count;
+  uint16_t category_count;
+  int32_t audio_sample_frequency;
+  // The whole record, header included.
+  uint32_t size;
+  // Of everything after the header.
+  uint32_t checksum;
+};
+
+template <typename Settings = DefaultModelSettings>
+struct PipelineSnapshot {
+  PipelineSnapshotHeader header;
+  FeatureProviderSnapshot<Settings> features;
+  RecognizerSnapshot<Settings> recognizer;
+};
+
+constexpr uint32_t kPipelineSnapshotMagic = 0x50535053;  // "SPSP"
+// Bump this whenever any of the snapshot structs changes.
+constexpr uint16_t kPipelineSnapshotVersion = 1;
+
+// A 32-bit FNV-1a hash of `size` bytes at `data`.
+uint32_t PipelineSnapshotChecksum(const void* data, int size);
+
+// Fills in `snapshot`'s header, for `Settings` and its current contents.
+template <typename Settings>
+void SealPipelineSnapshot(PipelineSnapshot<Settings>* snapshot) {
+  PipelineSnapshotHeader* header = &snapshot->header;
+  header->magic = kPipelineSnapshotMagic;
+  header->version = kPipelineSnapshotVersion;
+  header->feature_slice_size = Settings::kFeatureSliceSize;
+  header->feature_slice_count = Settings::kFeatureSliceCount;
+  header->category_count = Settings::kCategoryCount;
+  header->audio_sample_frequency = Settings::kAudioSampleFrequency;
+  header->size = sizeof(*snapshot);
+  header->checksum = PipelineSnapshotChecksum(
+      &snapshot->features, sizeof(*snapshot) - sizeof(snapshot->header));
+}
+
+// Whether `snapshot` was sealed by this version of the code for `Settings`
+// and hasn't been changed since, so it's safe to restore.
+template <typename Settings>
+bool IsValidPipelineSnapshot(const PipelineSnapshot<Settings>& snapshot) {
+  const PipelineSnapshotHeader& header = snapshot.header;
+  return (header.magic == kPipelineSnapshotMagic) &&
+         (header.version == kPipelineSnapshotVersion) &&
+         (header.feature_slice_size == Settings::kFeatureSliceSize) &&
+         (header.feature_slice_count == Settings::kFeatureSliceCount) &&
+         (header.category_count == Settings::kCategoryCount) &&
+         (header.audio_sample_frequency == Settings::kAudioSampleFrequency) &&
+         (header.size == sizeof(snapshot)) &&
+         (header.checksum ==
+          PipelineSnapshotChecksum(&snapshot.features,
+                                   sizeof(snapshot) - sizeof(snapshot.header)));
+}
+
+// Saves the state of `feature_provider` and `recognizer` into `snapshot` and
+// seals it. `current_sample` is where the sample clock is now.
+template <typename AudioSource, typename Settings>
+void TakePipelineSnapshot(
+    const FeatureProvider<AudioSource, Settings>& feature_provider,
+    const RecognizeCommands<Settings>& recognizer, int64_t current_sample,
+    PipelineSnapshot<Settings>* snapshot) {
+  feature_provider.SaveState(&snapshot->features);
+  recognizer.SaveState(current_sample, &snapshot->recognizer);
+  SealPipelineSnapshot(snapshot);
+}
+
+// Puts the state in `snapshot` back into `feature_provider` and `recognizer`,
+// as if it had been taken at `current_sample`, which may be on a sample clock
+// that has since started over. Fails without changing anything if the
+// snapshot isn't valid, see IsValidPipelineSnapshot().
+template <typename AudioSource, typename Settings>
+TfLiteStatus RestorePipelineSnapshot(
+    const PipelineSnapshot<Settings>& snapshot, int64_t current_sample,
+    FeatureProvider<AudioSource, Settings>* feature_provider,
+    RecognizeCommands<Settings>* recognizer) {
+  if (!IsValidPipelineSnapshot(snapshot)) {
+    MicroPrintf("No valid pipeline snapshot to restore");
+    return kTfLiteError;
+  }
+  TfLiteStatus features_status =
+      feature_provider->RestoreState(snapshot.features);
+  if (features_status != kTfLiteOk) {
+    return features_status;
+  }
+  return recognizer->RestoreState(snapshot.recognizer, current_sample);
+}
+
+// Whether the sketch's setup() found a snapshot to restore.
+bool SketchSnapshotRestored();
+
+// Takes a snapshot of the sketch's pipeline and saves it now, for example
+// before going to sleep. loop() also saves one every second of audio.
+void SaveSketchSnapshot();
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_PIPELINE_SNAPSHOT_H_
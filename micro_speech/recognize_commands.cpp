@@ -19,21 +19,26 @@ limitations under the License.
 
 #undef DEBUG_MICRO_SPEECH
 
-RecognizeCommands::RecognizeCommands(int32_t average_window_duration_ms,
-                                     uint8_t detection_threshold,
-                                     int32_t suppression_ms,
-                                     int32_t minimum_count)
-    : average_window_duration_ms_(average_window_duration_ms),
+template <typename Settings>
+RecognizeCommands<Settings>::RecognizeCommands(
+    int32_t average_window_duration_ms, uint8_t detection_threshold,
+    int32_t suppression_ms, int32_t minimum_count)
+    : average_window_duration_samples_(
+          static_cast<int64_t>(average_window_duration_ms) *
+          kAudioSamplesPerMs),
       detection_threshold_(detection_threshold),
-      suppression_ms_(suppression_ms),
+      suppression_samples_(static_cast<int64_t>(suppression_ms) *
+                           kAudioSamplesPerMs),
       minimum_count_(minimum_count),
-      previous_results_() {
+      previous_results_(),
+      command_score_(0) {
   previous_top_label_ = kCategoryLabels[0];  // silence
-  previous_top_label_time_ = std::numeric_limits<int32_t>::min();
+  previous_top_label_time_ = std::numeric_limits<int64_t>::min();
 }
 
-TfLiteStatus RecognizeCommands::ProcessLatestResults(
-    const TfLiteTensor* latest_results, const int32_t current_time_ms,
+template <typename Settings>
+TfLiteStatus RecognizeCommands<Settings>::ProcessLatestResults(
+    const TfLiteTensor* latest_results, const int64_t current_sample,
     const char** found_command, uint8_t* score, bool* is_new_command) {
   if ((latest_results->dims->size != 2) ||
       (latest_results->dims->data[0] != 1) ||
@@ -54,41 +59,43 @@ TfLiteStatus RecognizeCommands::ProcessLatestResults(
   }
 
   if ((!previous_results_.empty()) &&
-      (current_time_ms < previous_results_.front().time_)) {
+      (current_sample < previous_results_.front().time_)) {
     MicroPrintf(
         "Results must be fed in increasing time order, but received a "
-        "timestamp of %d that was earlier than the previous one of %d",
-        current_time_ms, previous_results_.front().time_);
+        "timestamp of %dms that was earlier than the previous one of %dms",
+        static_cast<int>(current_sample / kAudioSamplesPerMs),
+        static_cast<int>(previous_results_.front().time_ / kAudioSamplesPerMs));
     return kTfLiteError;
   }
 
   // Prune any earlier results that are too old for the averaging window.
-  const int64_t time_limit = current_time_ms - average_window_duration_ms_;
+  const int64_t time_limit = current_sample - average_window_duration_samples_;
   while ((!previous_results_.empty()) &&
          previous_results_.front().time_ < time_limit) {
     previous_results_.pop_front();
   }
 
   // Add the latest results to the head of the queue.
-  previous_results_.push_back({current_time_ms, latest_results->data.int8});
+  previous_results_.push_back({current_sample, latest_results->data.int8});
 
   // If there are too few results, assume the result will be unreliable and
   // bail.
   const int64_t how_many_results = previous_results_.size();
   const int64_t earliest_time = previous_results_.front().time_;
-  const int64_t samples_duration = current_time_ms - earliest_time;
+  const int64_t samples_duration = current_sample - earliest_time;
   if ((how_many_results < minimum_count_) ||
-      (samples_duration < (average_window_duration_ms_ / 4))) {
+      (samples_duration < (average_window_duration_samples_ / 4))) {
     *found_command = previous_top_label_;
     *score = 0;
     *is_new_command = false;
+    command_score_ = 0;
     return kTfLiteOk;
   }
 
   // Calculate the average score across all the results in the window.
   int32_t average_scores[kCategoryCount];
   for (int offset = 0; offset < previous_results_.size(); ++offset) {
-    PreviousResultsQueue::Result previous_result =
+    typename PreviousResultsQueue<Settings>::Result previous_result =
         previous_results_.from_front(offset);
     const int8_t* scores = previous_result.scores;
     for (int i = 0; i < kCategoryCount; ++i) {
@@ -113,26 +120,34 @@ TfLiteStatus RecognizeCommands::ProcessLatestResults(
     }
   }
   const char* current_top_label = kCategoryLabels[current_top_index];
+  int32_t command_score = 0;
+  for (int i = 0; i < kCategoryCount; ++i) {
+    if ((i != kSilenceIndex) && (i != kUnknownIndex) &&
+        (average_scores[i] > command_score)) {
+      command_score = average_scores[i];
+    }
+  }
+  command_score_ = static_cast<uint8_t>(command_score);
 
   // If we've recently had another label trigger, assume one that occurs too
   // soon afterwards is a bad result.
   int64_t time_since_last_top;
   if ((previous_top_label_ == kCategoryLabels[0]) ||
-      (previous_top_label_time_ == std::numeric_limits<int32_t>::min())) {
-    time_since_last_top = std::numeric_limits<int32_t>::max();
+      (previous_top_label_time_ == std::numeric_limits<int64_t>::min())) {
+    time_since_last_top = std::numeric_limits<int64_t>::max();
   } else {
-    time_since_last_top = current_time_ms - previous_top_label_time_;
+    time_since_last_top = current_sample - previous_top_label_time_;
   }
   if ((current_top_score > detection_threshold_) &&
       ((current_top_label != previous_top_label_) ||
-       (time_since_last_top > suppression_ms_))) {
+       (time_since_last_top > suppression_samples_))) {
 #ifdef DEBUG_MICRO_SPEECH
     MicroPrintf("Scores: s %d u %d y %d n %d  %s -> %s", average_scores[0],
                 average_scores[1], average_scores[2], average_scores[3],
                 previous_top_label_, current_top_label);
 #endif  // DEBUG_MICRO_SPEECH
     previous_top_label_ = current_top_label;
-    previous_top_label_time_ = current_time_ms;
+    previous_top_label_time_ = current_sample;
     *is_new_command = true;
   } else {
 #ifdef DEBUG_MICRO_SPEECH
@@ -150,3 +165,60 @@ TfLiteStatus RecognizeCommands::ProcessLatestResults(
 
   return kTfLiteOk;
 }
+
+template <typename Settings>
+void RecognizeCommands<Settings>::SaveState(
+    int64_t current_sample, RecognizerSnapshot<Settings>* snapshot) const {
+  snapshot->result_count = previous_results_.size();
+  for (int offset = 0; offset < previous_results_.size(); ++offset) {
+    const typename PreviousResultsQueue<Settings>::Result& result =
+        previous_results_.from_front(offset);
+    snapshot->result_ages[offset] = result.time_ - current_sample;
+    for (int i = 0; i < kCategoryCount; ++i) {
+      snapshot->result_scores[offset][i] = result.scores[i];
+    }
+  }
+  snapshot->previous_top_label = 0;
+  for (int i = 0; i < kCategoryCount; ++i) {
+    if (previous_top_label_ == kCategoryLabels[i]) {
+      snapshot->previous_top_label = i;
+    }
+  }
+  snapshot->previous_top_label_age =
+      (previous_top_label_time_ == std::numeric_limits<int64_t>::min())
+          ? std::numeric_limits<int64_t>::min()
+          : previous_top_label_time_ - current_sample;
+}
+
+template <typename Settings>
+TfLiteStatus RecognizeCommands<Settings>::RestoreState(
+    const RecognizerSnapshot<Settings>& snapshot, int64_t current_sample) {
+  if ((snapshot.result_count < 0) ||
+      (snapshot.result_count > RecognizerSnapshot<Settings>::kMaxResults) ||
+      (snapshot.previous_top_label < 0) ||
+      (snapshot.previous_top_label >= kCategoryCount)) {
+    MicroPrintf("Bad recognizer snapshot");
+    return kTfLiteError;
+  }
+  while (!previous_results_.empty()) {
+    previous_results_.pop_front();
+  }
+  for (int offset = 0; offset < snapshot.result_count; ++offset) {
+    typename PreviousResultsQueue<Settings>::Result result;
+    result.time_ = current_sample + snapshot.result_ages[offset];
+    for (int i = 0; i < kCategoryCount; ++i) {
+      result.scores[i] = snapshot.result_scores[offset][i];
+    }
+    previous_results_.push_back(result);
+  }
+  previous_top_label_ = kCategoryLabels[snapshot.previous_top_label];
+  previous_top_label_time_ =
+      (snapshot.previous_top_label_age == std::numeric_limits<int64_t>::min())
+          ? std::numeric_limits<int64_t>::min()
+          : current_sample + snapshot.previous_top_label_age;
+  return kTfLiteOk;
+}
+
+// The configurations this is built for.
+template class RecognizeCommands<DefaultModelSettings>;
+template class RecognizeCommands<LowPowerModelSettings>;
@@ -27,26 +27,30 @@ limitations under the License.
 // short time period, so they can be averaged together to produce a more
 // accurate overall prediction. This doesn't use any dynamic memory allocation
 // so it's a better fit for microcontroller applications, but this does mean
-// there are hard limits on the number of results it can store.
+// there are hard limits on the number of results it can store. Each result
+// holds the scores of `Settings`' categories, see ModelSettings.
+template <typename Settings = DefaultModelSettings>
 class PreviousResultsQueue {
+  static constexpr int kCategoryCount = Settings::kCategoryCount;
+
  public:
   PreviousResultsQueue() : front_index_(0), size_(0) {}
 
   // Data structure that holds an inference result, and the time when it
-  // was recorded.
+  // was recorded, as a position on the audio sample clock.
   struct Result {
     Result() : time_(0), scores() {}
-    Result(int32_t time, int8_t* input_scores) : time_(time) {
+    Result(int64_t time, int8_t* input_scores) : time_(time) {
       for (int i = 0; i < kCategoryCount; ++i) {
         scores[i] = input_scores[i];
       }
     }
-    int32_t time_;
+    int64_t time_;
     int8_t scores[kCategoryCount];
   };
 
-  int size() { return size_; }
-  bool empty() { return size_ == 0; }
+  int size() const { return size_; }
+  bool empty() const { return size_ == 0; }
   Result& front() { return results_[front_index_]; }
   Result& back() {
     int back_index = front_index_ + (size_ - 1);
@@ -82,7 +86,7 @@ class PreviousResultsQueue {
   // Most of the functions are duplicates of dequeue containers, but this
   // is a helper that makes it easy to iterate through the contents of the
   // queue.
-  Result& from_front(int offset) {
+  const Result& from_front(int offset) const {
     if ((offset < 0) || (offset >= size_)) {
       MicroPrintf("Attempt to read beyond the end of the queue!");
       offset = size_ - 1;
@@ -93,15 +97,38 @@ class PreviousResultsQueue {
     }
     return results_[index];
   }
+  Result& from_front(int offset) {
+    return const_cast<Result&>(
+        static_cast<const PreviousResultsQueue*>(this)->from_front(offset));
+  }
 
- private:
   static constexpr int kMaxResults = 50;
+
+ private:
   Result results_[kMaxResults];
 
   int front_index_;
   int size_;
 };
 
+// The history RecognizeCommands averages over and the last command it
+// reported, for carrying them over a reset (see pipeline_snapshot.h). Times
+// are relative to when the snapshot was taken, so they can be put back on a
+// sample clock that has started again from 0.
+template <typename Settings = DefaultModelSettings>
+struct RecognizerSnapshot {
+  static constexpr int kMaxResults =
+      PreviousResultsQueue<Settings>::kMaxResults;
+
+  int32_t result_count;
+  int64_t result_ages[kMaxResults];
+  int8_t result_scores[kMaxResults][Settings::kCategoryCount];
+  // An index into kCategoryLabels.
+  int32_t previous_top_label;
+  // INT64_MIN if no command has been reported yet.
+  int64_t previous_top_label_age;
+};
+
 // This class is designed to apply a very primitive decoding model on top of the
 // instantaneous results from running an audio recognition model on a single
 // window of samples. It applies smoothing over time so that noisy individual
@@ -111,8 +138,17 @@ class PreviousResultsQueue {
 // want, and then feed results from running a TensorFlow model into the
 // processing method. The timestamp for each subsequent call should be
 // increasing from the previous, since the class is designed to process a stream
-// of data over time.
+// of data over time. Timestamps are positions on the 64-bit audio sample clock
+// (see AudioSource::LatestSampleCount()), so the windows line up exactly with
+// the audio and never wrap; the durations are configured in milliseconds.
+// `Settings` is the pipeline configuration the model belongs to, see
+// ModelSettings; this is built for DefaultModelSettings and
+// LowPowerModelSettings.
+template <typename Settings = DefaultModelSettings>
 class RecognizeCommands {
+  static constexpr int kCategoryCount = Settings::kCategoryCount;
+  static constexpr int kAudioSamplesPerMs = Settings::kAudioSamplesPerMs;
+
  public:
   // labels should be a list of the strings associated with each one-hot score.
   // The window duration controls the smoothing. Longer durations will give a
@@ -129,23 +165,43 @@ class RecognizeCommands {
                              int32_t suppression_ms = 1500,
                              int32_t minimum_count = 3);
 
-  // Call this with the results of running a model on sample data.
+  // Call this with the results of running a model on sample data, captured up
+  // to `current_sample`.
   TfLiteStatus ProcessLatestResults(const TfLiteTensor* latest_results,
-                                    const int32_t current_time_ms,
+                                    const int64_t current_sample,
                                     const char** found_command, uint8_t* score,
                                     bool* is_new_command);
 
+  // Copies the results in the averaging window and the last command reported
+  // into `snapshot`, with their times relative to `current_sample`.
+  void SaveState(int64_t current_sample,
+                 RecognizerSnapshot<Settings>* snapshot) const;
+
+  // Puts back the state SaveState() saved, as if it had been saved at
+  // `current_sample`, so the next result is averaged with the restored ones
+  // instead of waiting for `minimum_count` new ones.
+  TfLiteStatus RestoreState(const RecognizerSnapshot<Settings>& snapshot,
+                            int64_t current_sample);
+
+  // The highest average score of any command, leaving out silence and
+  // unknown, as of the last call to ProcessLatestResults(). It's 0 while there
+  // are too few results to average. A command is reported once this passes
+  // detection_threshold().
+  uint8_t command_score() const { return command_score_; }
+  uint8_t detection_threshold() const { return detection_threshold_; }
+
  private:
-  // Configuration
-  int32_t average_window_duration_ms_;
+  // Configuration, with durations converted to samples
+  int64_t average_window_duration_samples_;
   uint8_t detection_threshold_;
-  int32_t suppression_ms_;
+  int64_t suppression_samples_;
   int32_t minimum_count_;
 
   // Working variables
-  PreviousResultsQueue previous_results_;
+  PreviousResultsQueue<Settings> previous_results_;
   const char* previous_top_label_;
-  int32_t previous_top_label_time_;
+  int64_t previous_top_label_time_;
+  uint8_t command_score_;
 };
 
 #endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_RECOGNIZE_COMMANDS_H_
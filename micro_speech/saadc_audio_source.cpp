@@ -0,0 +1,287 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Only the source picked by sketch_audio_source.h is built, since each one
+// claims its peripheral's interrupt.
+#include "sketch_audio_source.h"
+
+#if defined(ARDUINO) && (!defined(ARDUINO_ARDUINO_NANO33BLE) || \
+    defined(SKETCH_AUDIO_SOURCE_PDM))
+#define ARDUINO_EXCLUDE_CODE
+#endif  // defined(ARDUINO) && (...)
+
+#ifndef ARDUINO_EXCLUDE_CODE
+
+#ifndef PPI_CHANNEL
+#define PPI_CHANNEL (7)
+#endif
+
+// Restarts the SAADC the moment a block is done, so no samples are missed
+// between blocks.
+#ifndef PPI_END_START_CHANNEL
+#define PPI_END_START_CHANNEL (8)
+#endif
+
+#ifndef ANALOG_PIN
+#define ANALOG_PIN A0
+#endif
+
+// Samples the SAADC writes by DMA before interrupting the CPU. Must divide
+// kAudioCaptureBufferSize.
+#ifndef ADC_BUFFER_SIZE
+#define ADC_BUFFER_SIZE 512
+#endif
+
+#ifndef SAMPLING_FREQUENCY
+#define SAMPLING_FREQUENCY 16000
+#endif
+
+#include "saadc_audio_source.h"
+
+#include <mbed.h>
+
+#include "micro_features_micro_model_settings.h"
+#include "tensorflow/lite/micro/micro_log.h"
+#include "test_over_serial/test_over_serial.h"
+
+
+using namespace test_over_serial;
+
+static_assert(kAudioCaptureBufferSize % ADC_BUFFER_SIZE == 0,
+              "The capture buffer must hold a whole number of DMA blocks");
+static_assert(ADC_BUFFER_SIZE % 2 == 0,
+              "Blocks are conditioned a pair of samples at a time");
+
+namespace {
+// The instance the interrupt handler and test_over_serial feed.
+SaadcAudioSource* g_source = nullptr;
+}  // namespace
+
+void SaadcAudioSource::Hal::SetBuffer(int16_t* buffer, uint32_t sample_count) {
+  NRF_SAADC->RESULT.PTR = reinterpret_cast<uint32_t>(buffer);
+  NRF_SAADC->RESULT.MAXCNT = sample_count;
+}
+
+void SaadcAudioSource::Hal::Start() { NRF_SAADC->TASKS_START = 1; }
+
+// The DMA engine can be writing the two blocks after the newest published
+// sample, so those don't count as history.
+SaadcAudioSource::SaadcAudioSource()
+    : AudioSource(2 * ADC_BUFFER_SIZE),
+      block_capture_(&hal_, ring().data(), ADC_BUFFER_SIZE,
+                     kAudioCaptureBufferSize / ADC_BUFFER_SIZE),
+      is_capturing_(false),
+      test_insert_silence_(true) {
+  g_source = this;
+}
+
+void SaadcAudioSource::HandleInterrupt() {
+  if (NRF_SAADC->EVENTS_END != 0)
+  {
+    NRF_SAADC->EVENTS_END = 0;
+    const int block = block_capture_.OnEnd();
+    // Turn the raw 12-bit codes into centred 16-bit audio before anything
+    // reads them.
+    ConditionAudioBlock(&conditioner_, block_capture_.BlockAt(block),
+                        ADC_BUFFER_SIZE);
+    // This is how we let the main thread know that another block (32ms at
+    // 16kHz) of new audio has been received
+    ring().Commit(ADC_BUFFER_SIZE);
+    // and wake it if it's asleep in WaitForCapture().
+    __SEV();
+  }
+  if (NRF_SAADC->EVENTS_STARTED != 0)
+  {
+    NRF_SAADC->EVENTS_STARTED = 0;
+    block_capture_.OnStarted();
+  }
+}
+
+// The timer triggers a SAMPLE task every 1 / <SAMPLING_FREQUENCY> seconds
+// through the PPI, and the SAADC's EasyDMA writes each result straight into
+// the capture buffer. This interrupt only fires once per ADC_BUFFER_SIZE
+// samples: END when a block is full and STARTED when the SAADC has moved on to
+// the next one.
+extern "C" void SAADC_IRQHandler_v( void )
+{
+  if (g_source != nullptr) {
+    g_source->HandleInterrupt();
+  }
+}
+
+// Initialize the analog to digital converter (ADC)
+// https://infocenter.nordicsemi.com/index.jsp?topic=%2Fcom.nordic.infocenter.nrf52832.ps.v1.1%2Fsaadc.html
+void initADC()
+{
+  nrf_saadc_disable();
+
+  NRF_SAADC->RESOLUTION = NRF_SAADC_RESOLUTION_12BIT;
+
+  NRF_SAADC->CH[2].CONFIG = ( SAADC_CH_CONFIG_GAIN_Gain1_4    << SAADC_CH_CONFIG_GAIN_Pos ) |
+                            ( SAADC_CH_CONFIG_MODE_SE         << SAADC_CH_CONFIG_MODE_Pos ) |
+                            ( SAADC_CH_CONFIG_REFSEL_VDD1_4   << SAADC_CH_CONFIG_REFSEL_Pos ) |
+                            ( SAADC_CH_CONFIG_RESN_Bypass     << SAADC_CH_CONFIG_RESN_Pos ) |
+                            ( SAADC_CH_CONFIG_RESP_Bypass     << SAADC_CH_CONFIG_RESP_Pos ) |
+                            ( SAADC_CH_CONFIG_TACQ_3us        << SAADC_CH_CONFIG_TACQ_Pos );
+
+  NRF_SAADC->CH[2].PSELP = SAADC_CH_PSELP_PSELP_AnalogInput2 << SAADC_CH_PSELP_PSELP_Pos;
+  NRF_SAADC->CH[2].PSELN = SAADC_CH_PSELN_PSELN_NC << SAADC_CH_PSELN_PSELN_Pos;
+
+  NRF_SAADC->EVENTS_END = 0;
+  NRF_SAADC->EVENTS_STARTED = 0;
+  nrf_saadc_int_enable( NRF_SAADC_INT_END | NRF_SAADC_INT_STARTED );
+  NVIC_SetPriority( SAADC_IRQn, 1UL );
+  NVIC_EnableIRQ( SAADC_IRQn );
+
+  nrf_saadc_enable();
+
+  NRF_SAADC->TASKS_CALIBRATEOFFSET = 1;
+  while ( NRF_SAADC->EVENTS_CALIBRATEDONE == 0 );
+  NRF_SAADC->EVENTS_CALIBRATEDONE = 0;
+  while ( NRF_SAADC->STATUS == ( SAADC_STATUS_STATUS_Busy << SAADC_STATUS_STATUS_Pos ) );
+}
+
+// Initialize a timer that triggers an interrupt every
+// 1 / <SAMPLING_FREQUENCY> seconds.
+// https://infocenter.nordicsemi.com/index.jsp?topic=%2Fcom.nordic.infocenter.nrf52832.ps.v1.1%2Fppi.html
+void initTimer4()
+{
+  NRF_TIMER4->MODE = TIMER_MODE_MODE_Timer;
+  NRF_TIMER4->BITMODE = TIMER_BITMODE_BITMODE_16Bit;
+  NRF_TIMER4->SHORTS = TIMER_SHORTS_COMPARE0_CLEAR_Enabled << TIMER_SHORTS_COMPARE0_CLEAR_Pos;
+  NRF_TIMER4->PRESCALER = 0;
+  NRF_TIMER4->CC[0] = 16000000 / SAMPLING_FREQUENCY; // Needs prescaler set to 0 (1:1) 16MHz clock
+}
+
+// Start the timer to trigger our interrupt function
+// that reads data from the ADC
+void startTimer4()
+{
+  NRF_TIMER4->TASKS_START = 1;
+}
+
+// Stop sampling and writing to the ring, so that another producer can take
+// over.
+void stopADC()
+{
+  NRF_TIMER4->TASKS_STOP = 1;
+  NRF_PPI->CHENCLR = ( 1UL << PPI_CHANNEL ) | ( 1UL << PPI_END_START_CHANNEL );
+  NVIC_DisableIRQ( SAADC_IRQn );
+  NRF_SAADC->TASKS_STOP = 1;
+}
+
+// Initialize the Programmable Peripheral Interconnect (PPI)
+// This allows us to have the ADC run separately from the CPU: the timer
+// triggers each sample, and the end of each DMA block immediately starts the
+// next one, without any CPU involvement.
+// https://infocenter.nordicsemi.com/index.jsp?topic=%2Fcom.nordic.infocenter.nrf52832.ps.v1.1%2Fppi.html
+void initPPI()
+{
+  NRF_PPI->CH[PPI_CHANNEL].EEP = ( uint32_t )&NRF_TIMER4->EVENTS_COMPARE[0];
+  NRF_PPI->CH[PPI_CHANNEL].TEP = ( uint32_t )&NRF_SAADC->TASKS_SAMPLE;
+  NRF_PPI->CH[PPI_END_START_CHANNEL].EEP = ( uint32_t )&NRF_SAADC->EVENTS_END;
+  NRF_PPI->CH[PPI_END_START_CHANNEL].TEP = ( uint32_t )&NRF_SAADC->TASKS_START;
+  NRF_PPI->CHENSET = ( 1UL << PPI_CHANNEL ) | ( 1UL << PPI_END_START_CHANNEL );
+}
+
+TfLiteStatus SaadcAudioSource::StartCapture() {
+  InitAudioConditioner(&conditioner_);
+  initADC();
+  initTimer4();
+  initPPI();
+  // Hand the SAADC its first block before the timer starts sampling
+  block_capture_.Start();
+  startTimer4();
+  is_capturing_ = true;
+  // Block until we have our first audio sample
+  WaitForCapture(0);
+
+  return kTfLiteOk;
+}
+
+void SaadcAudioSource::WaitForCapture(int64_t sample_count) {
+  // Test input only arrives when Capture() polls the serial port for it.
+  if (!is_capturing_) {
+    return;
+  }
+  // The interrupt signals an event after each block it publishes. WFE, unlike
+  // WFI, can't miss a block that lands between the check and the sleep: the
+  // event stays latched and the WFE returns at once. Any other interrupt also
+  // wakes it, and it goes back to sleep until the block it's waiting for.
+  while (static_cast<int64_t>(ring().write_position()) <= sample_count) {
+    __WFE();
+  }
+}
+
+void SaadcAudioSource::StopCapture() {
+  stopADC();
+  is_capturing_ = false;
+}
+
+int64_t SaadcAudioSource::ProcessTestInput() {
+  constexpr size_t samples_16ms = ((kAudioSampleFrequency / 1000) * 16);
+  TestOverSerial& test = TestOverSerial::Instance(kAUDIO_PCM_16KHZ_MONO_S16);
+
+  InputHandler handler = [](const InputBuffer* const input) {
+    if (0 == input->offset) {
+      // don't insert silence
+      g_source->test_insert_silence_ = false;
+    }
+
+    g_source->ring().Write(input->data.int16, input->length);
+
+    if (input->total == (input->offset + input->length)) {
+      // allow silence insertion again
+      g_source->test_insert_silence_ = true;
+    }
+    return true;
+  };
+
+  test.ProcessInput(&handler);
+
+  if (test_insert_silence_) {
+    // add 16ms of silence, as the capture would have delivered meanwhile
+    const int16_t silence = 0;
+    for (size_t i = 0; i < samples_16ms; i++) {
+      ring().Write(&silence, 1);
+    }
+  }
+
+  // Round the sample count to a multiple of 64ms,
+  // This emulates the block-wise capture during inference processing.
+  return (ring().write_position() / (samples_16ms * 4)) * (samples_16ms * 4);
+}
+
+int64_t SaadcAudioSource::Capture() {
+  TestOverSerial& test = TestOverSerial::Instance(kAUDIO_PCM_16KHZ_MONO_S16);
+  if (!test.IsTestMode()) {
+    // check serial port for test mode command
+    test.ProcessInput(nullptr);
+  }
+  if (test.IsTestMode()) {
+    if (is_capturing_) {
+      // stop capture from hardware, the test input carries on from the same
+      // position in the ring
+      StopCapture();
+    }
+    return ProcessTestInput();
+  } else {
+    // The SAADC interrupt publishes each block as it completes
+    return ring().write_position();
+  }
+  // NOTREACHED
+}
+
+#endif  // ARDUINO_EXCLUDE_CODE
@@ -0,0 +1,66 @@
+/* Copyright 2022 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_SAADC_AUDIO_SOURCE_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_SAADC_AUDIO_SOURCE_H_
+
+#include <cstdint>
+
+#include "audio_conditioner.h"
+#include "audio_source.h"
+#include "block_capture.h"
+
+// Captures an analog microphone on the nRF52840's SAADC. A timer triggers each
+// sample through the PPI, EasyDMA writes the samples straight into the capture
+// ring in blocks, and the SAADC interrupt conditions (audio_conditioner.h) and
+// publishes each block as it fills, so the CPU only sees one interrupt per
+// block, and sleeps in between. See saadc_audio_source.cpp for the pins, block
+// size and PPI channels.
+//
+// It also accepts audio over serial from the test_over_serial tool, in which
+// case the hardware capture is stopped. Only one instance can exist, since it
+// owns the SAADC.
+class SaadcAudioSource : public AudioSource<SaadcAudioSource> {
+ public:
+  SaadcAudioSource();
+
+  // AudioSource hooks.
+  TfLiteStatus StartCapture();
+  int64_t Capture();
+  void WaitForCapture(int64_t sample_count);
+
+  // Called from SAADC_IRQHandler_v.
+  void HandleInterrupt();
+
+  // Sets the DMA pointer and length for BlockCapture.
+  struct Hal {
+    void SetBuffer(int16_t* buffer, uint32_t sample_count);
+    void Start();
+  };
+
+ private:
+  int64_t ProcessTestInput();
+  void StopCapture();
+
+  Hal hal_;
+  BlockCapture<Hal> block_capture_;
+  // DC removal and scaling of each block, run in the interrupt.
+  AudioConditioner conditioner_;
+  bool is_capturing_;
+  // test_over_serial silence insertion flag
+  bool test_insert_silence_;
+};
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_SAADC_AUDIO_SOURCE_H_
@@ -0,0 +1,41 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_SKETCH_AUDIO_SOURCE_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_SKETCH_AUDIO_SOURCE_H_
+
+// Picks the audio source the sketch is built with, see audio_source.h. The
+// board samples an analog microphone on the SAADC; uncomment the define below
+// to use the PDM microphone of a Nano 33 BLE Sense instead. The host build
+// plays back WAV files.
+// #define SKETCH_AUDIO_SOURCE_PDM
+
+#if defined(ARDUINO)
+#if defined(SKETCH_AUDIO_SOURCE_PDM)
+#include "pdm_audio_source.h"
+using SketchAudioSource = PdmAudioSource;
+#else  // defined(SKETCH_AUDIO_SOURCE_PDM)
+#include "saadc_audio_source.h"
+using SketchAudioSource = SaadcAudioSource;
+#endif  // defined(SKETCH_AUDIO_SOURCE_PDM)
+#else  // defined(ARDUINO)
+#include "host_audio_sources.h"
+using SketchAudioSource = WavAudioSource;
+#endif  // defined(ARDUINO)
+
+// The sketch's audio source, so a host driver can load audio into it.
+SketchAudioSource* GetSketchAudioSource();
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_SKETCH_AUDIO_SOURCE_H_
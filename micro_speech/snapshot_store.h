@@ -0,0 +1,35 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_SNAPSHOT_STORE_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_SNAPSHOT_STORE_H_
+
+// Where the sketch keeps its pipeline snapshot (see pipeline_snapshot.h) so it
+// outlives the sketch itself. On the Nano 33 BLE it's a block of retained RAM
+// that startup code doesn't clear, kept powered through System OFF, so a reset
+// or a wake from deep sleep finds it; it's lost when the power is. On a host
+// it's a file.
+
+// Returns `size` bytes of storage for the snapshot, 8-byte aligned, holding
+// whatever was last saved there, which may be nothing valid. Returns null if
+// `size` is more than the store holds, or if the store has nowhere that would
+// survive. The sketch takes its snapshots straight into this.
+void* SnapshotRecord(int size);
+
+// Makes what's been written to SnapshotRecord() survive, if its storage needs
+// telling.
+void SaveSnapshotRecord();
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_SNAPSHOT_STORE_H_
@@ -0,0 +1,340 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stage_profiler.h"
+
+#include <cstring>
+
+#if defined(PROFILE_MICRO_SPEECH)
+#if defined(ARDUINO)
+#include <mbed.h>
+
+#include "Arduino.h"
+#else  // defined(ARDUINO)
+#include <time.h>
+
+#include <cstdio>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif  // defined(ARDUINO)
+#endif  // defined(PROFILE_MICRO_SPEECH)
+
+namespace {
+
+constexpr char kRecordMagic[4] = {'S', 'P', 'R', 'F'};
+
+uint32_t Fnv1a(uint32_t hash, const uint8_t* data, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+uint32_t ReadLe32(const uint8_t* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) |
+         (static_cast<uint32_t>(data[3]) << 24);
+}
+
+uint16_t ReadLe16(const uint8_t* data) { return data[0] | (data[1] << 8); }
+
+}  // namespace
+
+const char* ProfilerStageName(int stage) {
+  static const char* const kStageNames[kStageCount] = {
+      "idle",   "timestamp", "vad",       "features",
+      "copy",   "invoke",    "recognize", "respond",
+  };
+  return ((stage >= 0) && (stage < kStageCount)) ? kStageNames[stage] : "?";
+}
+
+int ProfilerBucketIndex(uint32_t ticks) {
+  if (ticks < kProfilerSubBuckets) {
+    return ticks;
+  }
+  const int msb = 31 - __builtin_clz(ticks);
+  const int shift = msb - kProfilerSubBucketBits;
+  return ((shift + 1) << kProfilerSubBucketBits) +
+         ((ticks >> shift) & (kProfilerSubBuckets - 1));
+}
+
+uint64_t ProfilerBucketLowerBound(int bucket) {
+  if (bucket < kProfilerSubBuckets) {
+    return bucket;
+  }
+  const int shift = (bucket >> kProfilerSubBucketBits) - 1;
+  return static_cast<uint64_t>(kProfilerSubBuckets +
+                               (bucket & (kProfilerSubBuckets - 1)))
+         << shift;
+}
+
+uint32_t ProfilerPercentile(const ProfilerHistogram& histogram,
+                            double percentile) {
+  if (histogram.count == 0) {
+    return 0;
+  }
+  uint64_t rank =
+      static_cast<uint64_t>((percentile / 100.0) * histogram.count + 0.999999);
+  if (rank < 1) {
+    rank = 1;
+  }
+  uint64_t seen = 0;
+  for (int bucket = 0; bucket < kProfilerBucketCount; ++bucket) {
+    seen += histogram.buckets[bucket];
+    if (seen >= rank) {
+      const uint64_t upper = ProfilerBucketLowerBound(bucket + 1) - 1;
+      return (upper < histogram.max_ticks) ? static_cast<uint32_t>(upper)
+                                           : histogram.max_ticks;
+    }
+  }
+  return histogram.max_ticks;
+}
+
+double ProfilerIdleShare(const ProfilerHistogram histograms[kStageCount]) {
+  uint64_t total_ticks = 0;
+  for (int stage = 0; stage < kStageCount; ++stage) {
+    total_ticks += histograms[stage].total_ticks;
+  }
+  if (total_ticks == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(histograms[kStageIdle].total_ticks) /
+         total_ticks;
+}
+
+bool ProfilerParseRecord(const uint8_t* data, size_t size,
+                         uint32_t* tick_frequency,
+                         ProfilerHistogram histograms[kStageCount]) {
+  if ((size < kProfilerRecordSize) ||
+      (memcmp(data, kRecordMagic, sizeof(kRecordMagic)) != 0) ||
+      (ReadLe16(data + 4) != kProfilerRecordVersion) ||
+      (ReadLe16(data + 6) != kStageCount) ||
+      (ReadLe16(data + 8) != kProfilerBucketCount) ||
+      (ReadLe16(data + 10) != kProfilerSubBucketBits)) {
+    return false;
+  }
+  const size_t checksum_offset = kProfilerRecordSize - sizeof(uint32_t);
+  if (Fnv1a(2166136261u, data, checksum_offset) !=
+      ReadLe32(data + checksum_offset)) {
+    return false;
+  }
+  *tick_frequency = ReadLe32(data + 12);
+  const uint8_t* cursor = data + kProfilerRecordHeaderSize;
+  for (int stage = 0; stage < kStageCount; ++stage) {
+    ProfilerHistogram& histogram = histograms[stage];
+    histogram.count = ReadLe32(cursor);
+    histogram.max_ticks = ReadLe32(cursor + 4);
+    histogram.total_ticks =
+        ReadLe32(cursor + 8) | (static_cast<uint64_t>(ReadLe32(cursor + 12))
+                                << 32);
+    cursor += 16;
+    for (int bucket = 0; bucket < kProfilerBucketCount; ++bucket) {
+      histogram.buckets[bucket] = ReadLe32(cursor);
+      cursor += sizeof(uint32_t);
+    }
+  }
+  return true;
+}
+
+#if defined(PROFILE_MICRO_SPEECH)
+
+namespace {
+
+ProfilerHistogram g_histograms[kStageCount];
+uint32_t g_last_mark_ticks = 0;
+
+#if defined(ARDUINO)
+
+void InitTicks() {
+  // The DWT cycle counter is off after reset.
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+inline uint32_t ReadTicks() { return DWT->CYCCNT; }
+
+uint32_t TickFrequency() { return SystemCoreClock; }
+
+#else  // defined(ARDUINO)
+
+uint64_t NowNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// The TSC frequency is measured against CLOCK_MONOTONIC between the first
+// tick read and each dump.
+uint64_t g_calibration_tsc = 0;
+uint64_t g_calibration_ns = 0;
+
+void InitTicks() {
+  g_calibration_ns = NowNs();
+  g_calibration_tsc = __rdtsc();
+}
+
+inline uint32_t ReadTicks() { return static_cast<uint32_t>(__rdtsc()); }
+
+uint32_t TickFrequency() {
+  const uint64_t elapsed_ns = NowNs() - g_calibration_ns;
+  const uint64_t elapsed_tsc = __rdtsc() - g_calibration_tsc;
+  if (elapsed_ns == 0) {
+    return 1000000000u;
+  }
+  return static_cast<uint32_t>((elapsed_tsc * 1e9) / elapsed_ns);
+}
+#else   // defined(__x86_64__) || defined(__i386__)
+void InitTicks() {}
+
+inline uint32_t ReadTicks() { return static_cast<uint32_t>(NowNs()); }
+
+uint32_t TickFrequency() { return 1000000000u; }
+#endif  // defined(__x86_64__) || defined(__i386__)
+
+#endif  // defined(ARDUINO)
+
+bool g_ticks_initialized = false;
+
+void PutLe16(uint8_t* data, uint16_t value) {
+  data[0] = value & 0xff;
+  data[1] = value >> 8;
+}
+
+void PutLe32(uint8_t* data, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    data[i] = (value >> (i * 8)) & 0xff;
+  }
+}
+
+void RecordDuration(ProfileStage stage, uint32_t elapsed) {
+  ProfilerHistogram& histogram = g_histograms[stage];
+  histogram.count += 1;
+  histogram.total_ticks += elapsed;
+  if (elapsed > histogram.max_ticks) {
+    histogram.max_ticks = elapsed;
+  }
+  histogram.buckets[ProfilerBucketIndex(elapsed)] += 1;
+}
+
+}  // namespace
+
+void ProfilerBeginLoop() {
+  if (!g_ticks_initialized) {
+    InitTicks();
+    g_ticks_initialized = true;
+  }
+  g_last_mark_ticks = ReadTicks();
+}
+
+void ProfilerMark(ProfileStage stage) {
+  const uint32_t now = ReadTicks();
+  // Unsigned subtraction copes with the counter wrapping.
+  const uint32_t elapsed = now - g_last_mark_ticks;
+  g_last_mark_ticks = now;
+  RecordDuration(stage, elapsed);
+}
+
+void ProfilerMarkMicros(ProfileStage stage, uint64_t elapsed_us) {
+  g_last_mark_ticks = ReadTicks();
+  // In ticks, as the histograms and the record are, saturating rather than
+  // wrapping for a wait longer than the counter spans.
+  const uint64_t elapsed = (elapsed_us * TickFrequency() + 500000) / 1000000;
+  RecordDuration(stage, (elapsed > UINT32_MAX) ? UINT32_MAX
+                                               : static_cast<uint32_t>(elapsed));
+}
+
+void ProfilerDump(ProfilerWriter writer, void* context) {
+  uint8_t header[kProfilerRecordHeaderSize];
+  memcpy(header, kRecordMagic, sizeof(kRecordMagic));
+  PutLe16(header + 4, kProfilerRecordVersion);
+  PutLe16(header + 6, kStageCount);
+  PutLe16(header + 8, kProfilerBucketCount);
+  PutLe16(header + 10, kProfilerSubBucketBits);
+  PutLe32(header + 12, TickFrequency());
+  uint32_t checksum = Fnv1a(2166136261u, header, sizeof(header));
+  writer(header, sizeof(header), context);
+
+  // Stream one field at a time so no record-sized buffer is needed.
+  for (int stage = 0; stage < kStageCount; ++stage) {
+    const ProfilerHistogram& histogram = g_histograms[stage];
+    uint8_t fields[16];
+    PutLe32(fields, histogram.count);
+    PutLe32(fields + 4, histogram.max_ticks);
+    PutLe32(fields + 8, static_cast<uint32_t>(histogram.total_ticks));
+    PutLe32(fields + 12, static_cast<uint32_t>(histogram.total_ticks >> 32));
+    checksum = Fnv1a(checksum, fields, sizeof(fields));
+    writer(fields, sizeof(fields), context);
+    for (int bucket = 0; bucket < kProfilerBucketCount; ++bucket) {
+      uint8_t count[4];
+      PutLe32(count, histogram.buckets[bucket]);
+      checksum = Fnv1a(checksum, count, sizeof(count));
+      writer(count, sizeof(count), context);
+    }
+  }
+  uint8_t trailer[4];
+  PutLe32(trailer, checksum);
+  writer(trailer, sizeof(trailer), context);
+
+  memset(g_histograms, 0, sizeof(g_histograms));
+}
+
+#if defined(ARDUINO)
+
+namespace {
+
+void WriteToSerial(const uint8_t* data, size_t size, void*) {
+  Serial.write(data, size);
+}
+
+}  // namespace
+
+void ProfilerPoll() {
+  // Only peek, so any other serial traffic is left for TestOverSerial.
+  if ((Serial.available() > 0) && (Serial.peek() == kProfilerDumpRequest)) {
+    Serial.read();
+    ProfilerDump(WriteToSerial, nullptr);
+  }
+}
+
+#else  // defined(ARDUINO)
+
+void ProfilerPoll() {}
+
+void ProfilerPrintSummary() {
+  const double ticks_per_us = TickFrequency() / 1e6;
+  printf("%-10s %10s %10s %10s %10s %10s %10s\n", "stage", "calls",
+         "mean us", "p50 us", "p90 us", "p99 us", "max us");
+  for (int stage = 0; stage < kStageCount; ++stage) {
+    const ProfilerHistogram& histogram = g_histograms[stage];
+    const double mean =
+        histogram.count ? static_cast<double>(histogram.total_ticks) /
+                              histogram.count
+                        : 0.0;
+    printf("%-10s %10u %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+           ProfilerStageName(stage), histogram.count, mean / ticks_per_us,
+           ProfilerPercentile(histogram, 50) / ticks_per_us,
+           ProfilerPercentile(histogram, 90) / ticks_per_us,
+           ProfilerPercentile(histogram, 99) / ticks_per_us,
+           histogram.max_ticks / ticks_per_us);
+  }
+  printf("idle: %.1f%% of the loop's time\n",
+         ProfilerIdleShare(g_histograms) * 100.0);
+}
+
+#endif  // defined(ARDUINO)
+
+#endif  // defined(PROFILE_MICRO_SPEECH)
@@ -0,0 +1,147 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_STAGE_PROFILER_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_STAGE_PROFILER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Uncomment to collect per-stage latency histograms on the device. They're
+// sent over serial when the host writes kProfilerDumpRequest, and the
+// host/profile_decode tool turns them into p50/p99/max tables. The host build
+// always profiles.
+// #define PROFILE_MICRO_SPEECH
+#if !defined(ARDUINO) && !defined(PROFILE_MICRO_SPEECH)
+#define PROFILE_MICRO_SPEECH
+#endif
+
+// The stages of one pass through loop(). Each call to ProfilerMark() charges
+// the time elapsed since the previous mark (or since ProfilerBeginLoop()) to
+// the stage that just finished.
+enum ProfileStage {
+  // Asleep waiting for the capture to deliver audio the loop hasn't seen.
+  kStageIdle = 0,
+  kStageTimestamp,
+  kStageVoiceActivity,
+  kStageFeatures,
+  kStageCopy,
+  kStageInvoke,
+  kStageRecognize,
+  kStageRespond,
+  kStageCount,
+};
+
+// Durations are measured in ticks of a free-running counter: the DWT cycle
+// counter on the Cortex-M4, the TSC (or CLOCK_MONOTONIC nanoseconds) on the
+// host. Each stage keeps a histogram of them with logarithmic buckets, four
+// per power of two, so any percentile read from it is within 25% of the
+// true value while the whole thing fits in a few KB of static memory.
+constexpr int kProfilerSubBucketBits = 2;
+constexpr int kProfilerSubBuckets = 1 << kProfilerSubBucketBits;
+constexpr int kProfilerBucketCount =
+    (32 - kProfilerSubBucketBits + 1) * kProfilerSubBuckets;
+
+struct ProfilerHistogram {
+  uint32_t count;
+  uint32_t max_ticks;
+  uint64_t total_ticks;
+  uint32_t buckets[kProfilerBucketCount];
+};
+
+// Byte the host sends over serial to ask the device for a profile record.
+constexpr uint8_t kProfilerDumpRequest = 0x10;
+
+// Layout of a serialized record, all fields little-endian:
+//   "SPRF", u16 version, u16 stage count, u16 bucket count,
+//   u16 sub-bucket bits, u32 tick frequency in Hz,
+//   then per stage: u32 count, u32 max, u64 total, u32 buckets[bucket count],
+//   then u32 FNV-1a checksum of everything before it.
+// Version 2 added the voice activity stage, and version 3 the idle stage.
+constexpr uint16_t kProfilerRecordVersion = 3;
+constexpr size_t kProfilerRecordHeaderSize = 16;
+constexpr size_t kProfilerRecordSize =
+    kProfilerRecordHeaderSize +
+    kStageCount * (16 + kProfilerBucketCount * sizeof(uint32_t)) +
+    sizeof(uint32_t);
+
+// Receives successive chunks of a serialized record.
+typedef void (*ProfilerWriter)(const uint8_t* data, size_t size,
+                               void* context);
+
+// Returns a short name for `stage`, for printing.
+const char* ProfilerStageName(int stage);
+
+// Returns the bucket a duration of `ticks` is counted in.
+int ProfilerBucketIndex(uint32_t ticks);
+
+// Returns the smallest duration counted in `bucket`.
+uint64_t ProfilerBucketLowerBound(int bucket);
+
+// Returns the duration below which `percentile` (0 to 100) of the samples in
+// `histogram` fall, rounded up to the end of its bucket and capped at the
+// largest sample seen.
+uint32_t ProfilerPercentile(const ProfilerHistogram& histogram,
+                            double percentile);
+
+// Returns the share of all the time recorded, from 0 to 1, that was spent in
+// kStageIdle: how much headroom the pipeline had. The idle stage is timed with
+// a clock that keeps running in sleep, see ProfilerMarkMicros().
+double ProfilerIdleShare(const ProfilerHistogram histograms[kStageCount]);
+
+// Parses a record written by ProfilerDump() from the start of `data`. Returns
+// false if it's truncated, corrupt or an unknown version.
+bool ProfilerParseRecord(const uint8_t* data, size_t size,
+                         uint32_t* tick_frequency,
+                         ProfilerHistogram histograms[kStageCount]);
+
+#if defined(PROFILE_MICRO_SPEECH)
+
+// Starts timing a new pass through the loop.
+void ProfilerBeginLoop();
+
+// Records the end of `stage`.
+void ProfilerMark(ProfileStage stage);
+
+// Records the end of `stage`, charging it `elapsed_us` microseconds measured
+// by the caller rather than the ticks since the last mark. For kStageIdle: the
+// DWT cycle counter stops while the core sleeps in WFE, so on the device the
+// ticks would leave out most of the wait. See IdleMeter.
+void ProfilerMarkMicros(ProfileStage stage, uint64_t elapsed_us);
+
+// Serializes the histograms collected so far through `writer`, then clears
+// them so the next record covers only what happens after this one.
+void ProfilerDump(ProfilerWriter writer, void* context);
+
+// On the device, checks the serial port for kProfilerDumpRequest and answers
+// it with a record.
+void ProfilerPoll();
+
+#if !defined(ARDUINO)
+// Prints the count, p50, p90, p99 and maximum duration of each stage, and the
+// idle share.
+void ProfilerPrintSummary();
+#endif  // !defined(ARDUINO)
+
+#else  // defined(PROFILE_MICRO_SPEECH)
+
+inline void ProfilerBeginLoop() {}
+inline void ProfilerMark(ProfileStage) {}
+inline void ProfilerMarkMicros(ProfileStage, uint64_t) {}
+inline void ProfilerPoll() {}
+
+#endif  // defined(PROFILE_MICRO_SPEECH)
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_STAGE_PROFILER_H_
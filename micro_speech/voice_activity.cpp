@@ -0,0 +1,90 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "voice_activity.h"
+
+template <typename Settings>
+void InitVoiceActivityDetector(VoiceActivityDetector<Settings>* detector) {
+  detector->noise_floor = kVoiceActivityMinimumPower;
+  detector->hangover_frames =
+      VoiceActivityDetector<Settings>::kHangoverFrames;
+  detector->is_floor_set = false;
+}
+
+template <typename Settings>
+bool DetectVoiceActivity(VoiceActivityDetector<Settings>* detector,
+                         const int16_t* samples, int count) {
+  constexpr int kUnvoicedCrossings =
+      VoiceActivityDetector<Settings>::kUnvoicedCrossings;
+  constexpr int kHangoverFrames =
+      VoiceActivityDetector<Settings>::kHangoverFrames;
+  if (count <= 0) {
+    return detector->hangover_frames > 0;
+  }
+  int64_t sum_of_squares = 0;
+  int crossings = 0;
+  bool was_negative = samples[0] < 0;
+  for (int i = 0; i < count; ++i) {
+    const int32_t sample = samples[i];
+    sum_of_squares += sample * sample;
+    const bool is_negative = sample < 0;
+    crossings += (is_negative != was_negative) ? 1 : 0;
+    was_negative = is_negative;
+  }
+  const uint32_t power = static_cast<uint32_t>(sum_of_squares / count);
+
+  uint32_t floor = detector->noise_floor;
+  if (!detector->is_floor_set) {
+    floor = power;
+    detector->is_floor_set = true;
+  }
+  if (floor < kVoiceActivityMinimumPower) {
+    floor = kVoiceActivityMinimumPower;
+  }
+  const uint64_t floor64 = floor;
+  const bool is_voiced = power >= floor64 * kVoiceActivityVoicedRatio;
+  const bool is_unvoiced =
+      (power >= floor64 * kVoiceActivityUnvoicedRatio) &&
+      (crossings >= kUnvoicedCrossings);
+
+  // Falls a quarter of the way to a quieter frame, rises 1/256 of the way to
+  // a louder one.
+  if (power < floor) {
+    floor -= (floor - power) >> 2;
+  } else {
+    floor += (power - floor) >> 8;
+  }
+  detector->noise_floor =
+      (floor < kVoiceActivityMinimumPower) ? kVoiceActivityMinimumPower : floor;
+
+  if (is_voiced || is_unvoiced) {
+    detector->hangover_frames = kHangoverFrames;
+  } else if (detector->hangover_frames > 0) {
+    detector->hangover_frames -= 1;
+  }
+  return detector->hangover_frames > 0;
+}
+
+// The configurations the templates above are built for.
+template void InitVoiceActivityDetector<DefaultModelSettings>(
+    VoiceActivityDetector<DefaultModelSettings>* detector);
+template void InitVoiceActivityDetector<LowPowerModelSettings>(
+    VoiceActivityDetector<LowPowerModelSettings>* detector);
+template bool DetectVoiceActivity<DefaultModelSettings>(
+    VoiceActivityDetector<DefaultModelSettings>* detector,
+    const int16_t* samples, int count);
+template bool DetectVoiceActivity<LowPowerModelSettings>(
+    VoiceActivityDetector<LowPowerModelSettings>* detector,
+    const int16_t* samples, int count);
@@ -0,0 +1,196 @@
+/* Copyright 2023 The SPRD Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_VOICE_ACTIVITY_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_VOICE_ACTIVITY_H_
+
+#include <cstdint>
+
+#include "feature_provider.h"
+#include "micro_features_micro_model_settings.h"
+#include "tensorflow/lite/c/common.h"
+
+// A cheap voice activity detector, so the sketch can skip feature generation
+// and inference while the room is quiet, which is most of the time.
+//
+// Each frame of audio (one feature stride, 20ms) is measured for its mean
+// power and its zero-crossing rate, against a noise floor that follows the
+// quietest recent frames: it falls quickly and rises slowly, so it tracks a
+// changing background without being pulled up by speech. A frame is speech if
+// it's loud (voiced sounds), or if it's a little louder than the floor and
+// crosses zero often (unvoiced onsets like "s" and "f", which carry little
+// energy). Activity then holds for a hangover period after the last speech
+// frame, so the end of a word and the recognizer's averaging window are seen
+// through. The detector starts out active for one hangover while the floor
+// settles, so it fails open.
+//
+// Frames and the hangover are in the units of a pipeline configuration,
+// `Settings` (see ModelSettings). It's built for DefaultModelSettings and
+// LowPowerModelSettings.
+template <typename Settings = DefaultModelSettings>
+struct VoiceActivityDetector {
+  // Frames are this long.
+  static constexpr int kFrameSamples = Settings::kFeatureSliceStrideSamples;
+  // Unvoiced speech crosses zero at least this often per frame (a quarter of
+  // the samples).
+  static constexpr int kUnvoicedCrossings = kFrameSamples / 4;
+  // Activity lasts this long after the last speech frame, a whole model
+  // window.
+  static constexpr int kHangoverFrames = Settings::kFeatureSliceCount;
+
+  // Mean power per sample of the background.
+  uint32_t noise_floor;
+  // Frames left before activity ends.
+  int hangover_frames;
+  bool is_floor_set;
+};
+
+// Speech is this many times the floor's power (9dB) ...
+constexpr int kVoiceActivityVoicedRatio = 8;
+// ... or this many times (3dB) with at least kUnvoicedCrossings zero
+// crossings.
+constexpr int kVoiceActivityUnvoicedRatio = 2;
+// The floor never drops below this (an RMS of 10), so digital silence and
+// the quietest microphone noise don't make every sound an onset.
+constexpr uint32_t kVoiceActivityMinimumPower = 100;
+
+// Starts a detector over, active for one hangover.
+template <typename Settings>
+void InitVoiceActivityDetector(VoiceActivityDetector<Settings>* detector);
+
+// Classifies the next frame and returns whether voice activity, including the
+// hangover, is still going on.
+template <typename Settings>
+bool DetectVoiceActivity(VoiceActivityDetector<Settings>* detector,
+                         const int16_t* samples, int count);
+
+// How many of the newest slices are computed when activity starts, so the
+// onset of a word and a little of what came before it are in the window.
+// The older slices in the window are whatever was computed before the skip,
+// which after a short pause is the hangover, but after a longer one is audio
+// from further back than the window reaches, so the gate says when to clear
+// them (see VoiceActivityGate::window_is_stale()).
+constexpr int kVoiceActivityPrerollSlices = 25;
+
+// Gates the sketch's loop() on voice activity. `AudioSource` is the type of
+// the source the audio comes from, see audio_source.h, and `Settings` the
+// pipeline configuration it feeds, see ModelSettings.
+template <typename AudioSource, typename Settings = DefaultModelSettings>
+class VoiceActivityGate {
+ public:
+  static constexpr int kFrameSamples =
+      VoiceActivityDetector<Settings>::kFrameSamples;
+  static constexpr int kFeatureSliceCount = Settings::kFeatureSliceCount;
+  static constexpr int kFeatureSliceStrideSamples =
+      Settings::kFeatureSliceStrideSamples;
+  static constexpr int kFeatureSliceDurationSamples =
+      Settings::kFeatureSliceDurationSamples;
+  static_assert(kVoiceActivityPrerollSlices <= kFeatureSliceCount,
+                "The pre-roll has to fit in the window");
+
+  explicit VoiceActivityGate(AudioSource* audio_source,
+                             int preroll_slices = kVoiceActivityPrerollSlices)
+      : audio_source_(audio_source), preroll_slices_(preroll_slices) {
+    InitVoiceActivityDetector(&detector_);
+  }
+
+  // Runs the detector over the audio captured before `current_sample`, and
+  // returns whether the features and model should run. While they shouldn't,
+  // `*next_slice_sample` (where the next feature slice starts) is moved up so
+  // that no more than the pre-roll is waiting, and the audio before it is
+  // released, so the recognizer still sees the true time when activity
+  // resumes.
+  bool Update(int64_t current_sample, int64_t* next_slice_sample) {
+    window_is_stale_ = false;
+    // After a stall, only the last window's worth of audio is worth looking
+    // at, and older audio may have been overwritten.
+    const int64_t oldest_useful =
+        current_sample -
+        static_cast<int64_t>(kFeatureSliceCount) * kFrameSamples;
+    if (detected_sample_ < oldest_useful) {
+      detected_sample_ = oldest_useful;
+    }
+    while (detected_sample_ + kFrameSamples <= current_sample) {
+      const int16_t* samples = nullptr;
+      int samples_size = 0;
+      if (audio_source_->PeekSamples(detected_sample_, kFrameSamples,
+                                     &samples_size, &samples) != kTfLiteOk) {
+        break;
+      }
+      is_active_ = DetectVoiceActivity(&detector_, samples, samples_size);
+      detected_sample_ += kFrameSamples;
+    }
+    const bool has_new_slices =
+        NewFeatureSlicesAvailable<Settings>(*next_slice_sample,
+                                            current_sample) > 0;
+    if (is_active_) {
+      // If the slices skipped would have filled the window up to the
+      // pre-roll, nothing computed before the skip belongs in it any more.
+      window_is_stale_ =
+          skipped_slices_ >= static_cast<int64_t>(kFeatureSliceCount -
+                                                  preroll_slices_);
+      skipped_slices_ = 0;
+      passes_run_ += has_new_slices ? 1 : 0;
+      return true;
+    }
+    if (has_new_slices) {
+      passes_skipped_ += 1;
+      // The newest slice whose window has been captured.
+      const int64_t newest_slice =
+          ((current_sample - kFeatureSliceDurationSamples) /
+           kFeatureSliceStrideSamples) *
+          kFeatureSliceStrideSamples;
+      const int64_t earliest_kept =
+          newest_slice - static_cast<int64_t>(preroll_slices_ - 1) *
+                             kFeatureSliceStrideSamples;
+      if (*next_slice_sample < earliest_kept) {
+        skipped_slices_ += (earliest_kept - *next_slice_sample) /
+                           kFeatureSliceStrideSamples;
+        *next_slice_sample = earliest_kept;
+        audio_source_->ReleaseSamples(earliest_kept);
+      }
+    }
+    return false;
+  }
+
+  // Whether the last Update() reopened the gate after skipping so much audio
+  // that the slices older than the pre-roll are from outside the window, and
+  // should be cleared (see FeatureProvider::ClearFeatureData()) rather than
+  // run through the model next to it.
+  bool window_is_stale() const { return window_is_stale_; }
+
+  // Passes through the loop with new slices that did and didn't run the model.
+  uint32_t passes_run() const { return passes_run_; }
+  uint32_t passes_skipped() const { return passes_skipped_; }
+
+ private:
+  AudioSource* audio_source_;
+  const int preroll_slices_;
+  VoiceActivityDetector<Settings> detector_;
+  // The detector has seen the audio before this.
+  int64_t detected_sample_ = 0;
+  bool is_active_ = true;
+  // Slices skipped since the gate last let the features run.
+  int64_t skipped_slices_ = 0;
+  bool window_is_stale_ = false;
+  uint32_t passes_run_ = 0;
+  uint32_t passes_skipped_ = 0;
+};
+
+// The sketch's counts of passes through loop() with new audio that did and
+// didn't run the model.
+void GetVoiceActivityStats(uint32_t* passes_run, uint32_t* passes_skipped);
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_MICRO_SPEECH_VOICE_ACTIVITY_H_